@@ -0,0 +1,206 @@
+/* dentry.c: Cache of directory lookups. */
+
+#include "filesys/dentry.h"
+#include <hash.h>
+#include <list.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Dentry cache.
+ *
+ * Maps (directory inode sector, name) to the sector of the named
+ * file's inode, so that repeated lookups of the same path never
+ * reach the directory's data.  Negative entries, whose sector is
+ * DENTRY_NONE, remember names that are absent.  The directory code
+ * keeps the cache current: dir_add() and dir_remove() overwrite the
+ * entry for the name they change.
+ *
+ * A lookup that misses reads the directory without DENTRY_LOCK, so a
+ * change can land between that read and the fill.  Every change bumps
+ * DENTRY_GEN, and dentry_fill() stores nothing if it has moved since
+ * the lookup began.
+ *
+ * At most DENTRY_CACHE_SIZE entries are kept; beyond that the least
+ * recently used one is reused.  DENTRY_LOCK guards everything. */
+#define DENTRY_CACHE_SIZE 256
+
+struct dentry {
+	struct hash_elem hash_elem;     /* Element in DENTRIES. */
+	struct list_elem lru_elem;      /* Element in LRU. */
+	disk_sector_t parent;           /* Directory inode sector. */
+	char name[NAME_MAX + 1];        /* Name within PARENT. */
+	disk_sector_t sector;           /* Inode sector, or DENTRY_NONE. */
+};
+
+static struct hash dentries;
+static struct list lru;             /* Most recently used first. */
+static size_t dentry_cnt;
+static unsigned dentry_gen;         /* Bumped by every change. */
+static struct lock dentry_lock;
+
+static long long dentry_hit_cnt;    /* Lookups answered by the cache. */
+static long long dentry_miss_cnt;   /* Lookups that read the directory. */
+
+static uint64_t
+dentry_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct dentry *d = hash_entry (e, struct dentry, hash_elem);
+	return hash_string (d->name) ^ hash_int (d->parent);
+}
+
+static bool
+dentry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+		void *aux UNUSED) {
+	const struct dentry *a = hash_entry (a_, struct dentry, hash_elem);
+	const struct dentry *b = hash_entry (b_, struct dentry, hash_elem);
+
+	if (a->parent != b->parent)
+		return a->parent < b->parent;
+	return strcmp (a->name, b->name) < 0;
+}
+
+/* Initializes the dentry cache. */
+void
+dentry_init (void) {
+	hash_init (&dentries, dentry_hash, dentry_less, NULL);
+	list_init (&lru);
+	lock_init (&dentry_lock);
+}
+
+/* Returns the entry for NAME in PARENT, or a null pointer.
+ * DENTRY_LOCK must be held. */
+static struct dentry *
+dentry_find (disk_sector_t parent, const char *name) {
+	struct dentry key;
+	struct hash_elem *e;
+
+	key.parent = parent;
+	strlcpy (key.name, name, sizeof key.name);
+	e = hash_find (&dentries, &key.hash_elem);
+	return e != NULL ? hash_entry (e, struct dentry, hash_elem) : NULL;
+}
+
+/* Looks up NAME in directory PARENT.  On a hit, stores the inode
+ * sector of NAME, or DENTRY_NONE if NAME is absent, in *SECTORP
+ * and returns true.  Returns false if the cache does not know. */
+bool
+dentry_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp) {
+	struct dentry *d;
+
+	if (strlen (name) > NAME_MAX)
+		return false;
+
+	lock_acquire (&dentry_lock);
+	d = dentry_find (parent, name);
+	if (d != NULL) {
+		list_remove (&d->lru_elem);
+		list_push_front (&lru, &d->lru_elem);
+		*sectorp = d->sector;
+		dentry_hit_cnt++;
+	} else
+		dentry_miss_cnt++;
+	lock_release (&dentry_lock);
+	return d != NULL;
+}
+
+/* Makes NAME in PARENT map to SECTOR.  DENTRY_LOCK must be held. */
+static void
+dentry_store (disk_sector_t parent, const char *name,
+		disk_sector_t sector) {
+	struct dentry *d;
+
+	ASSERT (lock_held_by_current_thread (&dentry_lock));
+
+	d = dentry_find (parent, name);
+	if (d != NULL)
+		list_remove (&d->lru_elem);
+	else {
+		if (dentry_cnt < DENTRY_CACHE_SIZE) {
+			d = malloc (sizeof *d);
+			if (d != NULL)
+				dentry_cnt++;
+		}
+		if (d == NULL) {
+			if (list_empty (&lru))
+				return;
+			d = list_entry (list_pop_back (&lru), struct dentry, lru_elem);
+			hash_delete (&dentries, &d->hash_elem);
+		}
+		d->parent = parent;
+		strlcpy (d->name, name, sizeof d->name);
+		hash_insert (&dentries, &d->hash_elem);
+	}
+	d->sector = sector;
+	list_push_front (&lru, &d->lru_elem);
+}
+
+/* Records that NAME in directory PARENT is now the inode at SECTOR,
+ * or is absent if SECTOR is DENTRY_NONE.  Called after the directory
+ * itself has been changed. */
+void
+dentry_insert (disk_sector_t parent, const char *name,
+		disk_sector_t sector) {
+	lock_acquire (&dentry_lock);
+	dentry_gen++;
+	if (strlen (name) <= NAME_MAX)
+		dentry_store (parent, name, sector);
+	lock_release (&dentry_lock);
+}
+
+/* Returns the current generation, to pass to dentry_fill(). */
+unsigned
+dentry_generation (void) {
+	unsigned gen;
+
+	lock_acquire (&dentry_lock);
+	gen = dentry_gen;
+	lock_release (&dentry_lock);
+	return gen;
+}
+
+/* Caches SECTOR for NAME in PARENT, as read from the directory after
+ * dentry_generation() returned GENERATION.  Does nothing if the cache
+ * has changed since, because the read may be stale. */
+void
+dentry_fill (disk_sector_t parent, const char *name,
+		disk_sector_t sector, unsigned generation) {
+	if (strlen (name) > NAME_MAX)
+		return;
+
+	lock_acquire (&dentry_lock);
+	if (dentry_gen == generation)
+		dentry_store (parent, name, sector);
+	lock_release (&dentry_lock);
+}
+
+/* Drops every entry for names in directory PARENT, whose inode is
+ * going away. */
+void
+dentry_purge (disk_sector_t parent) {
+	struct list_elem *e, *next;
+
+	lock_acquire (&dentry_lock);
+	dentry_gen++;
+	for (e = list_begin (&lru); e != list_end (&lru); e = next) {
+		struct dentry *d = list_entry (e, struct dentry, lru_elem);
+
+		next = list_next (e);
+		if (d->parent == parent) {
+			list_remove (&d->lru_elem);
+			hash_delete (&dentries, &d->hash_elem);
+			free (d);
+			dentry_cnt--;
+		}
+	}
+	lock_release (&dentry_lock);
+}
+
+/* Prints dentry cache statistics. */
+void
+dentry_print_stats (void) {
+	printf ("Dentry cache: %lld hits, %lld misses\n",
+			dentry_hit_cnt, dentry_miss_cnt);
+}
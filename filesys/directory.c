@@ -1,7 +1,9 @@
 #include "filesys/directory.h"
 #include <stdio.h>
 #include <string.h>
+#include <hash.h>
 #include <list.h>
+#include "filesys/dentry.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
@@ -9,7 +11,13 @@
 /* A directory. */
 struct dir {
 	struct inode *inode;                /* Backing store. */
-	off_t pos;                          /* Current position. */
+
+	/* dir_readdir() position: the last name returned and its hash.
+	 * Names are returned in increasing (hash, name) order, so the
+	 * position survives entries being added, removed or moved. */
+	bool pos_valid;                     /* False until a name is read. */
+	uint32_t pos_hash;                  /* Hash of POS_NAME. */
+	char pos_name[NAME_MAX + 1];        /* Last name returned. */
 };
 
 /* A single directory entry. */
@@ -19,6 +27,94 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
+/* A directory is stored in one of two formats.
+ *
+ * A small directory is a plain array of dir_entry.  Once it needs
+ * more than DIR_LINEAR_MAX entries it is converted to the hashed
+ * format: a header sector, then 2**DEPTH buckets of one sector
+ * each.  A name lives in the bucket selected by the top DEPTH bits
+ * of its hash, so finding it takes one bucket read however large
+ * the directory is.  When a bucket is full, the directory doubles
+ * its bucket count, splitting bucket I into 2I and 2I + 1.
+ *
+ * Neither the conversion nor a split is crash-safe.  Both rewrite
+ * sectors in place, and the buffer cache writes them back in no
+ * particular order, so a crash in the middle can lose names. */
+#define DIR_MAGIC 0x48524944                /* "DIRH". */
+#define BUCKET_ENTRIES (DISK_SECTOR_SIZE / sizeof (struct dir_entry))
+#define DIR_LINEAR_MAX BUCKET_ENTRIES
+#define DIR_MIN_DEPTH 2
+#define DIR_MAX_DEPTH 16
+
+/* Header of a hashed directory, at offset 0.  Its first bytes read
+ * as a dir_entry that is not in use. */
+struct dir_header {
+	uint32_t magic;                     /* DIR_MAGIC. */
+	uint32_t depth;                     /* Log2 of the bucket count. */
+};
+
+/* A bucket of a hashed directory. */
+struct dir_bucket {
+	struct dir_entry entries[BUCKET_ENTRIES];
+};
+
+/* Returns the hash of NAME. */
+static uint32_t
+name_hash (const char *name) {
+	return hash_string (name) >> 32;
+}
+
+/* Compares the directory positions (HA, A) and (HB, B), returning
+ * a negative, zero or positive value like strcmp(). */
+static int
+pos_cmp (uint32_t ha, const char *a, uint32_t hb, const char *b) {
+	if (ha != hb)
+		return ha < hb ? -1 : 1;
+	return strcmp (a, b);
+}
+
+/* Returns the byte offset of bucket B. */
+static off_t
+bucket_ofs (size_t b) {
+	return (off_t) (b + 1) * DISK_SECTOR_SIZE;
+}
+
+/* Returns the bucket that HASH belongs in at DEPTH. */
+static size_t
+bucket_of (uint32_t hash, uint32_t depth) {
+	return hash >> (32 - depth);
+}
+
+/* Returns the depth of DIR, or 0 if DIR is in the linear format. */
+static uint32_t
+dir_depth (const struct dir *dir) {
+	struct dir_header h;
+
+	if (inode_read_at (dir->inode, &h, sizeof h, 0) != sizeof h
+			|| h.magic != DIR_MAGIC)
+		return 0;
+	return h.depth;
+}
+
+static bool
+read_bucket (const struct dir *dir, size_t b, struct dir_bucket *bucket) {
+	return inode_read_at (dir->inode, bucket, sizeof *bucket, bucket_ofs (b))
+		== sizeof *bucket;
+}
+
+static bool
+write_bucket (struct dir *dir, size_t b, const struct dir_bucket *bucket) {
+	return inode_write_at (dir->inode, bucket, sizeof *bucket, bucket_ofs (b))
+		== sizeof *bucket;
+}
+
+static bool
+write_depth (struct dir *dir, uint32_t depth) {
+	struct dir_header h = { .magic = DIR_MAGIC, .depth = depth };
+
+	return inode_write_at (dir->inode, &h, sizeof h, 0) == sizeof h;
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -33,7 +129,7 @@ dir_open (struct inode *inode) {
 	struct dir *dir = calloc (1, sizeof *dir);
 	if (inode != NULL && dir != NULL) {
 		dir->inode = inode;
-		dir->pos = 0;
+		dir->pos_valid = false;
 		return dir;
 	} else {
 		inode_close (inode);
@@ -80,21 +176,46 @@ static bool
 lookup (const struct dir *dir, const char *name,
 		struct dir_entry *ep, off_t *ofsp) {
 	struct dir_entry e;
-	size_t ofs;
+	struct dir_bucket *bucket;
+	uint32_t depth;
+	size_t ofs, b, i;
+	bool found = false;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (e.in_use && !strcmp (name, e.name)) {
-			if (ep != NULL)
-				*ep = e;
-			if (ofsp != NULL)
-				*ofsp = ofs;
-			return true;
+	depth = dir_depth (dir);
+	if (depth == 0) {
+		for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+				ofs += sizeof e)
+			if (e.in_use && !strcmp (name, e.name)) {
+				if (ep != NULL)
+					*ep = e;
+				if (ofsp != NULL)
+					*ofsp = ofs;
+				return true;
+			}
+		return false;
+	}
+
+	bucket = malloc (sizeof *bucket);
+	if (bucket == NULL)
+		return false;
+	b = bucket_of (name_hash (name), depth);
+	if (read_bucket (dir, b, bucket))
+		for (i = 0; i < BUCKET_ENTRIES; i++) {
+			e = bucket->entries[i];
+			if (e.in_use && !strcmp (name, e.name)) {
+				if (ep != NULL)
+					*ep = e;
+				if (ofsp != NULL)
+					*ofsp = bucket_ofs (b) + i * sizeof e;
+				found = true;
+				break;
+			}
 		}
-	return false;
+	free (bucket);
+	return found;
 }
 
 /* Searches DIR for a file with the given NAME
@@ -104,19 +225,158 @@ lookup (const struct dir *dir, const char *name,
 bool
 dir_lookup (const struct dir *dir, const char *name,
 		struct inode **inode) {
+	disk_sector_t parent, sector;
 	struct dir_entry e;
+	unsigned gen;
 
 	ASSERT (dir != NULL);
 	ASSERT (name != NULL);
 
-	if (lookup (dir, name, &e, NULL))
-		*inode = inode_open (e.inode_sector);
+	parent = inode_get_inumber (dir->inode);
+	if (!dentry_lookup (parent, name, &sector)) {
+		gen = dentry_generation ();
+		sector = lookup (dir, name, &e, NULL) ? e.inode_sector : DENTRY_NONE;
+		dentry_fill (parent, name, sector, gen);
+	}
+
+	if (sector != DENTRY_NONE)
+		*inode = inode_open (sector);
 	else
 		*inode = NULL;
 
 	return *inode != NULL;
 }
 
+/* Doubles the bucket count of DIR, which has DEPTH, using the
+ * three buckets in BUF.  Bucket I splits into 2I and 2I + 1, so
+ * working downward never overwrites a bucket that is still to be
+ * split.  The buckets are rewritten in place before the new depth,
+ * so this is not crash-safe; if a write fails, DIR is left corrupt. */
+static bool
+split (struct dir *dir, uint32_t depth, struct dir_bucket buf[3]) {
+	size_t b, i, n[2];
+
+	for (b = (size_t) 1 << depth; b-- > 0; ) {
+		if (!read_bucket (dir, b, &buf[0]))
+			return false;
+		memset (&buf[1], 0, 2 * sizeof *buf);
+		n[0] = n[1] = 0;
+		for (i = 0; i < BUCKET_ENTRIES; i++) {
+			struct dir_entry *e = &buf[0].entries[i];
+			int half;
+
+			if (!e->in_use)
+				continue;
+			half = bucket_of (name_hash (e->name), depth + 1) & 1;
+			buf[1 + half].entries[n[half]++] = *e;
+		}
+		if (!write_bucket (dir, 2 * b + 1, &buf[2])
+				|| !write_bucket (dir, 2 * b, &buf[1]))
+			return false;
+	}
+	return write_depth (dir, depth + 1);
+}
+
+/* Adds NAME to hashed directory DIR, splitting buckets until the
+ * bucket for NAME has room. */
+static bool
+hashed_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
+	struct dir_bucket *buf = malloc (3 * sizeof *buf);
+	uint32_t hash = name_hash (name);
+	uint32_t depth = dir_depth (dir);
+	bool success = false;
+	size_t b, i;
+
+	if (buf == NULL)
+		return false;
+	while (depth != 0) {
+		b = bucket_of (hash, depth);
+		if (!read_bucket (dir, b, &buf[0]))
+			break;
+		for (i = 0; i < BUCKET_ENTRIES; i++)
+			if (!buf[0].entries[i].in_use)
+				break;
+		if (i < BUCKET_ENTRIES) {
+			struct dir_entry *e = &buf[0].entries[i];
+
+			e->in_use = true;
+			strlcpy (e->name, name, sizeof e->name);
+			e->inode_sector = inode_sector;
+			success = inode_write_at (dir->inode, e, sizeof *e,
+					bucket_ofs (b) + i * sizeof *e) == sizeof *e;
+			break;
+		}
+		if (depth >= DIR_MAX_DEPTH || !split (dir, depth, buf))
+			break;
+		depth++;
+	}
+	free (buf);
+	return success;
+}
+
+/* Converts linear directory DIR to the hashed format.  The buckets
+ * are written first and the header last, so a failed bucket write
+ * leaves the linear entries in sector 0 untouched.  This gives no
+ * ordering on disk; see above. */
+static bool
+convert (struct dir *dir) {
+	off_t length = inode_length (dir->inode);
+	struct dir_entry *entries = malloc (length);
+	struct dir_bucket *buckets = NULL;
+	struct dir_header *h;
+	size_t cnt = length / sizeof *entries;
+	uint32_t depth = DIR_MIN_DEPTH;
+	bool success = false;
+	size_t b, i, j;
+
+	if (entries == NULL
+			|| inode_read_at (dir->inode, entries, length, 0) != length)
+		goto done;
+
+	/* Start with the buckets half full at most, and add more if a
+	 * bucket still overflows. */
+	while (((size_t) 1 << depth) * BUCKET_ENTRIES < 2 * cnt)
+		depth++;
+	for (;;) {
+		free (buckets);
+		buckets = calloc ((size_t) 1 << depth, sizeof *buckets);
+		if (buckets == NULL)
+			goto done;
+		for (i = 0; i < cnt; i++) {
+			if (!entries[i].in_use)
+				continue;
+			b = bucket_of (name_hash (entries[i].name), depth);
+			for (j = 0; j < BUCKET_ENTRIES; j++)
+				if (!buckets[b].entries[j].in_use)
+					break;
+			if (j == BUCKET_ENTRIES)
+				break;
+			buckets[b].entries[j] = entries[i];
+		}
+		if (i == cnt)
+			break;
+		if (++depth > DIR_MAX_DEPTH)
+			goto done;
+	}
+
+	for (b = 0; b < ((size_t) 1 << depth); b++)
+		if (!write_bucket (dir, b, &buckets[b]))
+			goto done;
+
+	/* The header, in a sector that holds no entries. */
+	memset (&buckets[0], 0, sizeof buckets[0]);
+	h = (struct dir_header *) &buckets[0];
+	h->magic = DIR_MAGIC;
+	h->depth = depth;
+	success = inode_write_at (dir->inode, &buckets[0], sizeof buckets[0], 0)
+		== sizeof buckets[0];
+
+done:
+	free (entries);
+	free (buckets);
+	return success;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
  * file by that name.  The file's inode is in sector
  * INODE_SECTOR.
@@ -140,25 +400,39 @@ dir_add (struct dir *dir, const char *name, disk_sector_t inode_sector) {
 	if (lookup (dir, name, NULL, NULL))
 		goto done;
 
-	/* Set OFS to offset of free slot.
-	 * If there are no free slots, then it will be set to the
-	 * current end-of-file.
-
-	 * inode_read_at() will only return a short read at end of file.
-	 * Otherwise, we'd need to verify that we didn't get a short
-	 * read due to something intermittent such as low memory. */
-	for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-			ofs += sizeof e)
-		if (!e.in_use)
-			break;
+	if (dir_depth (dir) == 0) {
+		/* Set OFS to offset of free slot.
+		 * If there are no free slots, then it will be set to the
+		 * current end-of-file.
+
+		 * inode_read_at() will only return a short read at end of file.
+		 * Otherwise, we'd need to verify that we didn't get a short
+		 * read due to something intermittent such as low memory. */
+		for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+				ofs += sizeof e)
+			if (!e.in_use)
+				break;
+
+		/* Switch to the hashed format rather than grow past
+		 * DIR_LINEAR_MAX entries. */
+		if (ofs >= (off_t) (DIR_LINEAR_MAX * sizeof e)) {
+			if (!convert (dir))
+				goto done;
+			success = hashed_add (dir, name, inode_sector);
+			goto done;
+		}
 
-	/* Write slot. */
-	e.in_use = true;
-	strlcpy (e.name, name, sizeof e.name);
-	e.inode_sector = inode_sector;
-	success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+		/* Write slot. */
+		e.in_use = true;
+		strlcpy (e.name, name, sizeof e.name);
+		e.inode_sector = inode_sector;
+		success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+	} else
+		success = hashed_add (dir, name, inode_sector);
 
 done:
+	if (success)
+		dentry_insert (inode_get_inumber (dir->inode), name, inode_sector);
 	return success;
 }
 
@@ -190,6 +464,8 @@ dir_remove (struct dir *dir, const char *name) {
 		goto done;
 
 	/* Remove inode. */
+	dentry_insert (inode_get_inumber (dir->inode), name, DENTRY_NONE);
+	dentry_purge (e.inode_sector);
 	inode_remove (inode);
 	success = true;
 
@@ -198,19 +474,64 @@ done:
 	return success;
 }
 
+/* Stores E as the next entry for DIR's position in NEXT, if it
+ * comes after the position and before NEXT. */
+static void
+consider (const struct dir *dir, const struct dir_entry *e,
+		struct dir_entry *next, uint32_t *next_hash) {
+	uint32_t hash;
+
+	if (!e->in_use)
+		return;
+	hash = name_hash (e->name);
+	if (dir->pos_valid
+			&& pos_cmp (hash, e->name, dir->pos_hash, dir->pos_name) <= 0)
+		return;
+	if (!next->in_use
+			|| pos_cmp (hash, e->name, *next_hash, next->name) < 0) {
+		*next = *e;
+		*next_hash = hash;
+	}
+}
+
 /* Reads the next directory entry in DIR and stores the name in
  * NAME.  Returns true if successful, false if the directory
- * contains no more entries. */
+ * contains no more entries.  Names are returned in hash order in
+ * both directory formats, so a directory converted or split
+ * between calls is still read exactly once through. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
-	struct dir_entry e;
-
-	while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) {
-		dir->pos += sizeof e;
-		if (e.in_use) {
-			strlcpy (name, e.name, NAME_MAX + 1);
-			return true;
+	struct dir_entry e, next;
+	struct dir_bucket *bucket;
+	uint32_t next_hash = 0;
+	uint32_t depth;
+	size_t ofs, b, i;
+
+	next.in_use = false;
+	depth = dir_depth (dir);
+	if (depth == 0) {
+		for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+				ofs += sizeof e)
+			consider (dir, &e, &next, &next_hash);
+	} else {
+		bucket = malloc (sizeof *bucket);
+		if (bucket == NULL)
+			return false;
+		b = dir->pos_valid ? bucket_of (dir->pos_hash, depth) : 0;
+		for (; !next.in_use && b < ((size_t) 1 << depth); b++) {
+			if (!read_bucket (dir, b, bucket))
+				break;
+			for (i = 0; i < BUCKET_ENTRIES; i++)
+				consider (dir, &bucket->entries[i], &next, &next_hash);
 		}
+		free (bucket);
 	}
-	return false;
+
+	if (!next.in_use)
+		return false;
+	dir->pos_valid = true;
+	dir->pos_hash = next_hash;
+	strlcpy (dir->pos_name, next.name, sizeof dir->pos_name);
+	strlcpy (name, next.name, NAME_MAX + 1);
+	return true;
 }
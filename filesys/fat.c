@@ -1,6 +1,9 @@
 #include "filesys/fat.h"
+#include <bitmap.h>
+#include <round.h>
 #include "devices/disk.h"
 #include "filesys/filesys.h"
+#include "filesys/page_cache.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
 #include <stdio.h>
@@ -9,7 +12,7 @@
 /* Should be less than DISK_SECTOR_SIZE */
 struct fat_boot {
 	unsigned int magic;
-	unsigned int sectors_per_cluster; /* Fixed to 1 */
+	unsigned int sectors_per_cluster; /* 1, 2, 4, 8 or 16. */
 	unsigned int total_sectors;
 	unsigned int fat_start;
 	unsigned int fat_sectors; /* Size of FAT in sectors. */
@@ -24,12 +27,30 @@ struct fat_fs {
 	disk_sector_t data_start;
 	cluster_t last_clst;
 	struct lock write_lock;
+
+	/* Free space index.  USED has a bit per cluster, set if the
+	 * cluster is in a chain or reserved; GROUP_FREE counts the free
+	 * clusters of each group of FREE_GROUP clusters, so that full
+	 * groups are skipped without looking at their bits. */
+	struct bitmap *used;
+	uint16_t *group_free;
+	size_t group_cnt;
+	size_t free_cnt;
+
+	/* FAT sectors changed since they were last written.  FAT changes
+	 * stay in memory until fat_flush(). */
+	struct bitmap *dirty;
 };
 
+#define FREE_GROUP 256
+
 static struct fat_fs *fat_fs;
 
+unsigned int fat_format_cluster_sectors = SECTORS_PER_CLUSTER;
+
 void fat_boot_create (void);
 void fat_fs_init (void);
+static void fat_index_build (void);
 
 void
 fat_init (void) {
@@ -78,6 +99,51 @@ fat_open (void) {
 			free (bounce);
 		}
 	}
+	fat_index_build ();
+}
+
+/* Writes sector I of the FAT to disk. */
+static void
+fat_write_sector (unsigned int i) {
+	static uint8_t bounce[DISK_SECTOR_SIZE];
+	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
+	off_t ofs = (off_t) i * DISK_SECTOR_SIZE;
+
+	if (ofs + DISK_SECTOR_SIZE <= fat_size_in_bytes)
+		disk_write (filesys_disk, fat_fs->bs.fat_start + i,
+		            (uint8_t *) fat_fs->fat + ofs);
+	else {
+		memset (bounce, 0, DISK_SECTOR_SIZE);
+		if (ofs < fat_size_in_bytes)
+			memcpy (bounce, (uint8_t *) fat_fs->fat + ofs,
+			        fat_size_in_bytes - ofs);
+		disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
+	}
+}
+
+/* Notes that the FAT entry of CLST changed.  Before the index is
+ * built, the whole FAT is going to be written anyway. */
+static void
+fat_mark_dirty (cluster_t clst) {
+	if (fat_fs->dirty != NULL)
+		bitmap_mark (fat_fs->dirty,
+				clst * sizeof (cluster_t) / DISK_SECTOR_SIZE);
+}
+
+/* Writes the FAT sectors that changed since the last flush. */
+void
+fat_flush (void) {
+	unsigned int i;
+
+	if (fat_fs == NULL || fat_fs->dirty == NULL)
+		return;
+	lock_acquire (&fat_fs->write_lock);
+	for (i = 0; i < fat_fs->bs.fat_sectors; i++)
+		if (bitmap_test (fat_fs->dirty, i)) {
+			bitmap_reset (fat_fs->dirty, i);
+			fat_write_sector (i);
+		}
+	lock_release (&fat_fs->write_lock);
 }
 
 void
@@ -90,27 +156,8 @@ fat_close (void) {
 	disk_write (filesys_disk, FAT_BOOT_SECTOR, bounce);
 	free (bounce);
 
-	// Write FAT directly to the disk
-	uint8_t *buffer = (uint8_t *) fat_fs->fat;
-	off_t bytes_wrote = 0;
-	off_t bytes_left = sizeof (fat_fs->fat);
-	const off_t fat_size_in_bytes = fat_fs->fat_length * sizeof (cluster_t);
-	for (unsigned i = 0; i < fat_fs->bs.fat_sectors; i++) {
-		bytes_left = fat_size_in_bytes - bytes_wrote;
-		if (bytes_left >= DISK_SECTOR_SIZE) {
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i,
-			            buffer + bytes_wrote);
-			bytes_wrote += DISK_SECTOR_SIZE;
-		} else {
-			bounce = calloc (1, DISK_SECTOR_SIZE);
-			if (bounce == NULL)
-				PANIC ("FAT close failed");
-			memcpy (bounce, buffer + bytes_wrote, bytes_left);
-			disk_write (filesys_disk, fat_fs->bs.fat_start + i, bounce);
-			bytes_wrote += bytes_left;
-			free (bounce);
-		}
-	}
+	// Write the changed part of the FAT
+	fat_flush ();
 }
 
 void
@@ -126,12 +173,14 @@ fat_create (void) {
 
 	// Set up ROOT_DIR_CLST
 	fat_put (ROOT_DIR_CLUSTER, EOChain);
+	fat_index_build ();
+	bitmap_set_all (fat_fs->dirty, true);
 
 	// Fill up ROOT_DIR_CLUSTER region with 0
 	uint8_t *buf = calloc (1, DISK_SECTOR_SIZE);
 	if (buf == NULL)
 		PANIC ("FAT create failed due to OOM");
-	disk_write (filesys_disk, cluster_to_sector (ROOT_DIR_CLUSTER), buf);
+	page_cache_write (cluster_to_sector (ROOT_DIR_CLUSTER), buf);
 	free (buf);
 }
 
@@ -139,10 +188,11 @@ void
 fat_boot_create (void) {
 	unsigned int fat_sectors =
 	    (disk_size (filesys_disk) - 1)
-	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * SECTORS_PER_CLUSTER + 1) + 1;
+	    / (DISK_SECTOR_SIZE / sizeof (cluster_t) * fat_format_cluster_sectors + 1)
+	    + 1;
 	fat_fs->bs = (struct fat_boot){
 	    .magic = FAT_MAGIC,
-	    .sectors_per_cluster = SECTORS_PER_CLUSTER,
+	    .sectors_per_cluster = fat_format_cluster_sectors,
 	    .total_sectors = disk_size (filesys_disk),
 	    .fat_start = 1,
 	    .fat_sectors = fat_sectors,
@@ -152,42 +202,225 @@ fat_boot_create (void) {
 
 void
 fat_fs_init (void) {
-	/* TODO: Your code goes here. */
+	unsigned int entries = fat_fs->bs.fat_sectors
+		* (DISK_SECTOR_SIZE / sizeof (cluster_t));
+
+	/* Cluster 0 means "none", so data clusters are numbered from 1. */
+	fat_fs->data_start = fat_fs->bs.fat_start + fat_fs->bs.fat_sectors;
+	fat_fs->fat_length = (fat_fs->bs.total_sectors - fat_fs->data_start)
+		/ fat_fs->bs.sectors_per_cluster + 1;
+	if (fat_fs->fat_length > entries)
+		fat_fs->fat_length = entries;
+	fat_fs->last_clst = ROOT_DIR_CLUSTER;
+	lock_init (&fat_fs->write_lock);
 }
 
 /*----------------------------------------------------------------------------*/
 /* FAT handling                                                               */
 /*----------------------------------------------------------------------------*/
 
+/* Builds the free space index from the FAT. */
+static void
+fat_index_build (void) {
+	cluster_t c;
+
+	bitmap_destroy (fat_fs->used);
+	bitmap_destroy (fat_fs->dirty);
+	free (fat_fs->group_free);
+	fat_fs->group_cnt = DIV_ROUND_UP (fat_fs->fat_length, FREE_GROUP);
+	fat_fs->used = bitmap_create (fat_fs->fat_length);
+	fat_fs->dirty = bitmap_create (fat_fs->bs.fat_sectors);
+	fat_fs->group_free = calloc (fat_fs->group_cnt, sizeof *fat_fs->group_free);
+	if (fat_fs->used == NULL || fat_fs->dirty == NULL
+			|| fat_fs->group_free == NULL)
+		PANIC ("FAT index creation failed");
+
+	fat_fs->free_cnt = 0;
+	bitmap_mark (fat_fs->used, 0);
+	for (c = 1; c < fat_fs->fat_length; c++)
+		if (fat_fs->fat[c] != 0)
+			bitmap_mark (fat_fs->used, c);
+		else {
+			fat_fs->group_free[c / FREE_GROUP]++;
+			fat_fs->free_cnt++;
+		}
+}
+
+/* Marks cluster C used (USED true) or free in the index. */
+static void
+index_set (cluster_t c, bool used) {
+	ASSERT (bitmap_test (fat_fs->used, c) != used);
+	bitmap_set (fat_fs->used, c, used);
+	if (used) {
+		fat_fs->group_free[c / FREE_GROUP]--;
+		fat_fs->free_cnt--;
+	} else {
+		fat_fs->group_free[c / FREE_GROUP]++;
+		fat_fs->free_cnt++;
+	}
+}
+
+/* Returns the first free cluster at or after FROM, wrapping around
+ * at the end of the FAT, or 0 if there is none. */
+static cluster_t
+index_find (cluster_t from) {
+	size_t first = from / FREE_GROUP;
+	size_t n;
+
+	if (fat_fs->free_cnt == 0)
+		return 0;
+	/* The last pass looks at FIRST's clusters before FROM. */
+	for (n = 0; n <= fat_fs->group_cnt; n++) {
+		size_t g = (first + n) % fat_fs->group_cnt;
+		size_t start = g * FREE_GROUP;
+		size_t end = start + FREE_GROUP;
+		size_t c;
+
+		if (fat_fs->group_free[g] == 0)
+			continue;
+		if (n == 0)
+			start = from;
+		else if (n == fat_fs->group_cnt)
+			end = from;
+		if (end > fat_fs->fat_length)
+			end = fat_fs->fat_length;
+		for (c = start; c < end; c++)
+			if (!bitmap_test (fat_fs->used, c))
+				return c;
+	}
+	return 0;
+}
+
+/* Reserves up to CNT consecutive free clusters, as near after CLST as
+ * possible (after the last allocation if CLST is 0), and stores the
+ * first in *STARTP.  Reserved clusters are not in any chain; link
+ * them in with fat_extend_chain() and give back the rest with
+ * fat_unreserve().  Returns the number reserved, 0 if the disk is
+ * full. */
+size_t
+fat_reserve (cluster_t clst, size_t cnt, cluster_t *startp) {
+	cluster_t c;
+	size_t n = 0;
+
+	ASSERT (cnt > 0);
+
+	lock_acquire (&fat_fs->write_lock);
+	if (clst == 0 || clst + 1 >= fat_fs->fat_length)
+		clst = fat_fs->last_clst;
+	c = index_find (clst + 1 < fat_fs->fat_length ? clst + 1 : 1);
+	if (c != 0) {
+		while (n < cnt && c + n < fat_fs->fat_length
+				&& !bitmap_test (fat_fs->used, c + n))
+			index_set (c + n++, true);
+		*startp = c;
+		fat_fs->last_clst = c + n - 1;
+	}
+	lock_release (&fat_fs->write_lock);
+	return n;
+}
+
+/* Releases CNT reserved clusters starting at START. */
+void
+fat_unreserve (cluster_t start, size_t cnt) {
+	lock_acquire (&fat_fs->write_lock);
+	for (; cnt > 0; start++, cnt--) {
+		ASSERT (fat_fs->fat[start] == 0);
+		index_set (start, false);
+	}
+	lock_release (&fat_fs->write_lock);
+}
+
+/* Links reserved cluster C after CLST, the end of a chain.  If CLST
+ * is 0, C starts a new chain. */
+void
+fat_extend_chain (cluster_t clst, cluster_t c) {
+	lock_acquire (&fat_fs->write_lock);
+	ASSERT (bitmap_test (fat_fs->used, c) && fat_fs->fat[c] == 0);
+	fat_fs->fat[c] = EOChain;
+	fat_mark_dirty (c);
+	if (clst != 0) {
+		fat_fs->fat[clst] = c;
+		fat_mark_dirty (clst);
+	}
+	lock_release (&fat_fs->write_lock);
+}
+
 /* Add a cluster to the chain.
  * If CLST is 0, start a new chain.
- * Returns 0 if fails to allocate a new cluster. */
+ * Returns 0 if fails to allocate a new cluster.
+ *
+ * The new cluster is the first free one after CLST, so that chains
+ * that grow one cluster at a time stay contiguous. */
 cluster_t
 fat_create_chain (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	cluster_t c;
+
+	if (fat_reserve (clst, 1, &c) == 0)
+		return 0;
+	fat_extend_chain (clst, c);
+	return c;
 }
 
 /* Remove the chain of clusters starting from CLST.
  * If PCLST is 0, assume CLST as the start of the chain. */
 void
 fat_remove_chain (cluster_t clst, cluster_t pclst) {
-	/* TODO: Your code goes here. */
+	lock_acquire (&fat_fs->write_lock);
+	if (pclst != 0) {
+		fat_fs->fat[pclst] = EOChain;
+		fat_mark_dirty (pclst);
+	}
+	while (clst != 0 && clst != EOChain) {
+		cluster_t next = fat_fs->fat[clst];
+
+		ASSERT (clst < fat_fs->fat_length);
+		fat_fs->fat[clst] = 0;
+		fat_mark_dirty (clst);
+		index_set (clst, false);
+		clst = next;
+	}
+	lock_release (&fat_fs->write_lock);
 }
 
 /* Update a value in the FAT table. */
 void
 fat_put (cluster_t clst, cluster_t val) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst > 0 && clst < fat_fs->fat_length);
+	fat_fs->fat[clst] = val;
+	fat_mark_dirty (clst);
 }
 
 /* Fetch a value in the FAT table. */
 cluster_t
 fat_get (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst > 0 && clst < fat_fs->fat_length);
+	return fat_fs->fat[clst];
 }
 
 /* Covert a cluster # to a sector number. */
 disk_sector_t
 cluster_to_sector (cluster_t clst) {
-	/* TODO: Your code goes here. */
+	ASSERT (clst > 0);
+	return fat_fs->data_start + (clst - 1) * fat_fs->bs.sectors_per_cluster;
+}
+
+/* Returns the number of free clusters and stores the total number of
+ * data clusters in *TOTALP. */
+size_t
+fat_free_clusters (size_t *totalp) {
+	*totalp = fat_fs->fat_length - 1;
+	return fat_fs->free_cnt;
+}
+
+/* Returns the number of sectors in a cluster. */
+unsigned int
+fat_cluster_sectors (void) {
+	return fat_fs->bs.sectors_per_cluster;
+}
+
+/* Covert a sector number to the cluster # that holds it. */
+cluster_t
+sector_to_cluster (disk_sector_t sector) {
+	ASSERT (sector >= fat_fs->data_start);
+	return (sector - fat_fs->data_start) / fat_fs->bs.sectors_per_cluster + 1;
 }
@@ -8,8 +8,48 @@ struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	off_t ra_pos;               /* Where a sequential read would start. */
+	off_t ra_end;               /* End of the readahead issued so far. */
+	int ra_window;              /* Readahead window, in sectors. */
 };
 
+/* Readahead window bounds, in sectors. */
+#define RA_MIN_SECTORS 4
+#define RA_MAX_SECTORS 32
+
+/* Called after reading BYTES at OFS of FILE.  While reads stay
+ * sequential, the window doubles up to RA_MAX_SECTORS and the sectors
+ * in it beyond the read are queued for the buffer cache to read in
+ * the background.  Any other read closes the window. */
+static void
+file_readahead (struct file *file, off_t ofs, off_t bytes) {
+	off_t end = ofs + bytes;
+	off_t limit;
+
+	if (bytes == 0)
+		return;
+	if (ofs != file->ra_pos) {
+		file->ra_pos = end;
+		file->ra_end = end;
+		file->ra_window = 0;
+		return;
+	}
+
+	if (file->ra_window == 0)
+		file->ra_window = RA_MIN_SECTORS;
+	else if (file->ra_window < RA_MAX_SECTORS)
+		file->ra_window *= 2;
+	file->ra_pos = end;
+	if (file->ra_end < end)
+		file->ra_end = end;
+
+	limit = end + file->ra_window * DISK_SECTOR_SIZE;
+	if (file->ra_end < limit) {
+		inode_readahead (file->inode, file->ra_end, limit - file->ra_end);
+		file->ra_end = limit;
+	}
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
@@ -72,6 +112,7 @@ file_get_inode (struct file *file) {
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
 	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	file_readahead (file, file->pos, bytes_read);
 	file->pos += bytes_read;
 	return bytes_read;
 }
@@ -83,7 +124,9 @@ file_read (struct file *file, void *buffer, off_t size) {
  * The file's current position is unaffected. */
 off_t
 file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) {
-	return inode_read_at (file->inode, buffer, size, file_ofs);
+	off_t bytes_read = inode_read_at (file->inode, buffer, size, file_ofs);
+	file_readahead (file, file_ofs, bytes_read);
+	return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into FILE,
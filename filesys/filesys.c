@@ -5,12 +5,20 @@
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
+#include "filesys/dentry.h"
 #include "filesys/directory.h"
+#include "filesys/page_cache.h"
 #include "devices/disk.h"
+#include "threads/synch.h"
 
 /* The disk that contains the file system. */
 struct disk *filesys_disk;
 
+/* Held while the free map or FAT is created, opened or closed, and
+ * while filesys_sync() flushes it, so that page_cache_kworkerd,
+ * which starts before formatting, never flushes one half set up. */
+static struct lock sync_lock;
+
 static void do_format (void);
 
 /* Initializes the file system module.
@@ -22,7 +30,11 @@ filesys_init (bool format) {
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
 	inode_init ();
+	lock_init (&sync_lock);
+	page_cache_init ();
+	dentry_init ();
 
+	lock_acquire (&sync_lock);
 #ifdef EFILESYS
 	fat_init ();
 
@@ -39,6 +51,7 @@ filesys_init (bool format) {
 
 	free_map_open ();
 #endif
+	lock_release (&sync_lock);
 }
 
 /* Shuts down the file system module, writing any unwritten data
@@ -46,11 +59,28 @@ filesys_init (bool format) {
 void
 filesys_done (void) {
 	/* Original FS */
+	lock_acquire (&sync_lock);
 #ifdef EFILESYS
 	fat_close ();
 #else
 	free_map_close ();
 #endif
+	lock_release (&sync_lock);
+	page_cache_done ();
+}
+
+/* Writes the file system metadata that changed since the last sync,
+ * then every dirty sector of the buffer cache, to disk. */
+void
+filesys_sync (void) {
+	lock_acquire (&sync_lock);
+#ifdef EFILESYS
+	fat_flush ();
+#else
+	free_map_flush ();
+#endif
+	lock_release (&sync_lock);
+	page_cache_flush ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -61,12 +91,25 @@ bool
 filesys_create (const char *name, off_t initial_size) {
 	disk_sector_t inode_sector = 0;
 	struct dir *dir = dir_open_root ();
+#ifdef EFILESYS
+	cluster_t inode_clst = dir != NULL ? fat_create_chain (0) : 0;
+	bool success;
+
+	if (inode_clst != 0)
+		inode_sector = cluster_to_sector (inode_clst);
+	success = (inode_clst != 0
+			&& inode_create (inode_sector, initial_size)
+			&& dir_add (dir, name, inode_sector));
+	if (!success && inode_clst != 0)
+		fat_remove_chain (inode_clst, 0);
+#else
 	bool success = (dir != NULL
 			&& free_map_allocate (1, &inode_sector)
 			&& inode_create (inode_sector, initial_size)
 			&& dir_add (dir, name, inode_sector));
 	if (!success && inode_sector != 0)
 		free_map_release (inode_sector, 1);
+#endif
 	dir_close (dir);
 
 	return success;
@@ -110,6 +153,8 @@ do_format (void) {
 #ifdef EFILESYS
 	/* Create FAT and save it to the disk. */
 	fat_create ();
+	if (!dir_create (ROOT_DIR_SECTOR, 16))
+		PANIC ("root directory creation failed");
 	fat_close ();
 #else
 	free_map_create ();
@@ -1,6 +1,7 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
@@ -8,6 +9,23 @@
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
 
+/* Sectors of the free map file that changed since the last flush.
+ * Changes reach the disk only through free_map_flush(). */
+static struct bitmap *free_map_dirty;
+
+#define SECTOR_BITS (DISK_SECTOR_SIZE * 8)
+
+/* Notes that bits START through START + CNT - 1 of the free map
+ * changed. */
+static void
+mark_dirty (disk_sector_t start, size_t cnt) {
+	size_t first = start / SECTOR_BITS;
+	size_t last = (start + cnt - 1) / SECTOR_BITS;
+
+	if (cnt > 0)
+		bitmap_set_multiple (free_map_dirty, first, last - first + 1, true);
+}
+
 /* Initializes the free map. */
 void
 free_map_init (void) {
@@ -16,6 +34,10 @@ free_map_init (void) {
 		PANIC ("bitmap creation failed--disk is too large");
 	bitmap_mark (free_map, FREE_MAP_SECTOR);
 	bitmap_mark (free_map, ROOT_DIR_SECTOR);
+	free_map_dirty = bitmap_create (DIV_ROUND_UP (bitmap_size (free_map),
+				SECTOR_BITS));
+	if (free_map_dirty == NULL)
+		PANIC ("bitmap creation failed--disk is too large");
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -25,23 +47,52 @@ free_map_init (void) {
 bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
 	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-	if (sector != BITMAP_ERROR
-			&& free_map_file != NULL
-			&& !bitmap_write (free_map, free_map_file)) {
-		bitmap_set_multiple (free_map, sector, cnt, false);
-		sector = BITMAP_ERROR;
-	}
-	if (sector != BITMAP_ERROR)
+	if (sector != BITMAP_ERROR) {
+		mark_dirty (sector, cnt);
 		*sectorp = sector;
+	}
 	return sector != BITMAP_ERROR;
 }
 
+/* Allocates up to CNT sectors starting at SECTOR, as many as are
+ * free in a row there.  Returns the number allocated, which is 0 if
+ * SECTOR itself is in use. */
+size_t
+free_map_extend (disk_sector_t sector, size_t cnt) {
+	size_t i;
+
+	for (i = 0; i < cnt && sector + i < bitmap_size (free_map); i++)
+		if (bitmap_test (free_map, sector + i))
+			break;
+	if (i == 0)
+		return 0;
+
+	bitmap_set_multiple (free_map, sector, i, true);
+	mark_dirty (sector, i);
+	return i;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
 	ASSERT (bitmap_all (free_map, sector, cnt));
 	bitmap_set_multiple (free_map, sector, cnt, false);
-	bitmap_write (free_map, free_map_file);
+	mark_dirty (sector, cnt);
+}
+
+/* Writes the changed sectors of the free map to its file. */
+void
+free_map_flush (void) {
+	size_t i;
+
+	if (free_map_file == NULL)
+		return;
+	for (i = 0; i < bitmap_size (free_map_dirty); i++)
+		if (bitmap_test (free_map_dirty, i)) {
+			bitmap_reset (free_map_dirty, i);
+			bitmap_write_at (free_map, free_map_file, i * DISK_SECTOR_SIZE,
+					DISK_SECTOR_SIZE);
+		}
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -57,7 +108,9 @@ free_map_open (void) {
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) {
+	free_map_flush ();
 	file_close (free_map_file);
+	free_map_file = NULL;
 }
 
 /* Creates a new free map file on disk and writes the free map to
@@ -74,4 +127,5 @@ free_map_create (void) {
 		PANIC ("can't open free map");
 	if (!bitmap_write (free_map, free_map_file))
 		PANIC ("can't write free map");
+	bitmap_set_all (free_map_dirty, false);
 }
@@ -6,9 +6,13 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "devices/disk.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
 #include "threads/vaddr.h"
 
 /* List files in the root directory. */
@@ -62,6 +66,131 @@ fsutil_rm (char **argv) {
 		PANIC ("%s: delete failed\n", file_name);
 }
 
+#ifdef EFILESYS
+#define BLOCK_NAME "clusters"
+#else
+#define BLOCK_NAME "sectors"
+#endif
+
+/* Prints how fragmented the files in the root directory are: the
+ * number of physically contiguous runs of each, and the average run
+ * length, per file and overall. */
+void
+fsutil_frag (char **argv UNUSED) {
+	struct dir *dir;
+	char name[NAME_MAX + 1];
+	size_t file_cnt = 0, total_runs = 0, total_blocks = 0;
+
+	printf ("Fragmentation of files in the root directory:\n");
+	dir = dir_open_root ();
+	if (dir == NULL)
+		PANIC ("root dir open failed");
+	while (dir_readdir (dir, name)) {
+		struct inode *inode;
+		size_t runs, blocks;
+
+		if (!dir_lookup (dir, name, &inode))
+			continue;
+		inode_layout (inode, &runs, &blocks);
+		inode_close (inode);
+
+		printf ("%s: %zu " BLOCK_NAME " in %zu runs", name, blocks, runs);
+		if (runs > 0)
+			printf (", avg run %zu.%zu", blocks / runs, blocks * 10 / runs % 10);
+		printf ("\n");
+		file_cnt++;
+		total_runs += runs;
+		total_blocks += blocks;
+	}
+	dir_close (dir);
+
+	printf ("%zu files, %zu " BLOCK_NAME " in %zu runs", file_cnt,
+			total_blocks, total_runs);
+	if (total_runs > 0)
+		printf (", avg run %zu.%zu", total_blocks / total_runs,
+				total_blocks * 10 / total_runs % 10);
+	printf ("\n");
+#ifdef EFILESYS
+	{
+		size_t total;
+		size_t free_cnt = fat_free_clusters (&total);
+
+		printf ("%zu of %zu clusters free\n", free_cnt, total);
+	}
+#endif
+}
+
+/* Parameters of fsutil_openbench(). */
+#define OPENBENCH_FILES 32
+#define OPENBENCH_THREADS 8
+#define OPENBENCH_ROUNDS 100
+
+static struct semaphore openbench_done;
+
+/* Opens every benchmark file, starting at file number AUX, then
+ * closes them all, OPENBENCH_ROUNDS times. */
+static void
+openbench_thread (void *aux) {
+	size_t first = (size_t) aux;
+	struct file *files[OPENBENCH_FILES];
+	char name[NAME_MAX + 1];
+	size_t r, i;
+
+	for (r = 0; r < OPENBENCH_ROUNDS; r++) {
+		for (i = 0; i < OPENBENCH_FILES; i++) {
+			snprintf (name, sizeof name, "ob%zu",
+					(first + i) % OPENBENCH_FILES);
+			files[i] = filesys_open (name);
+			if (files[i] == NULL)
+				PANIC ("%s: open failed", name);
+		}
+		for (i = 0; i < OPENBENCH_FILES; i++)
+			file_close (files[i]);
+	}
+	sema_up (&openbench_done);
+}
+
+/* Measures how fast OPENBENCH_THREADS threads can open and close
+ * the same OPENBENCH_FILES files concurrently. */
+void
+fsutil_openbench (char **argv UNUSED) {
+	char name[NAME_MAX + 1];
+	long long ops;
+	int64_t start, ticks;
+	size_t i;
+
+	for (i = 0; i < OPENBENCH_FILES; i++) {
+		snprintf (name, sizeof name, "ob%zu", i);
+		filesys_create (name, 0);
+	}
+
+	printf ("Opening %d files with %d threads...\n",
+			OPENBENCH_FILES, OPENBENCH_THREADS);
+	sema_init (&openbench_done, 0);
+	start = timer_ticks ();
+	for (i = 0; i < OPENBENCH_THREADS; i++) {
+		snprintf (name, sizeof name, "openbench%zu", i);
+		if (thread_create (name, PRI_DEFAULT, openbench_thread,
+					(void *) (i * OPENBENCH_FILES / OPENBENCH_THREADS))
+				== TID_ERROR)
+			PANIC ("%s: thread creation failed", name);
+	}
+	for (i = 0; i < OPENBENCH_THREADS; i++)
+		sema_down (&openbench_done);
+	ticks = timer_elapsed (start);
+
+	ops = (long long) OPENBENCH_THREADS * OPENBENCH_ROUNDS * OPENBENCH_FILES;
+	printf ("%lld opens and closes in %lld ticks", ops, (long long) ticks);
+	if (ticks > 0)
+		printf (" (%lld per second)", ops * TIMER_FREQ / ticks);
+	printf ("\n");
+
+	for (i = 0; i < OPENBENCH_FILES; i++) {
+		snprintf (name, sizeof name, "ob%zu", i);
+		filesys_remove (name);
+	}
+}
+
 /* Copies from the "scratch" disk, hdc or hd1:0 to file ARGV[1]
  * in the file system.
  *
@@ -1,23 +1,55 @@
 #include "filesys/inode.h"
-#include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
+#include "filesys/fat.h"
 #include "filesys/free-map.h"
+#include "filesys/page_cache.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* A run of LENGTH consecutive data sectors starting at START.  With
+ * FAT, a run of clusters. */
+struct extent {
+	disk_sector_t start;
+	uint32_t length;
+};
+
+#ifdef EFILESYS
 /* On-disk inode.
  * Must be exactly DISK_SECTOR_SIZE bytes long. */
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
+	cluster_t start;                    /* First data cluster, 0 if none. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
 	uint32_t unused[125];               /* Not used. */
 };
+#else
+/* Extents held in the inode itself, indirect extent blocks, and
+ * extents in each of those. */
+#define INODE_EXTENTS 60
+#define INDIRECT_BLOCKS 5
+#define BLOCK_EXTENTS (DISK_SECTOR_SIZE / sizeof (struct extent))
+#define MAX_EXTENTS (INODE_EXTENTS + INDIRECT_BLOCKS * BLOCK_EXTENTS)
+
+/* On-disk inode.
+ * Must be exactly DISK_SECTOR_SIZE bytes long.
+ *
+ * The file's data is the concatenation of its extents.  The first
+ * INODE_EXTENTS are stored here; the rest in the indirect blocks. */
+struct inode_disk {
+	off_t length;                       /* File size in bytes. */
+	unsigned magic;                     /* Magic number. */
+	uint32_t extent_cnt;                /* Number of extents. */
+	disk_sector_t indirect[INDIRECT_BLOCKS]; /* Indirect extent blocks. */
+	struct extent extents[INODE_EXTENTS];    /* First extents. */
+};
+#endif
 
 /* Returns the number of sectors to allocate for an inode SIZE
  * bytes long. */
@@ -28,35 +60,451 @@ bytes_to_sectors (off_t size) {
 
 /* In-memory inode. */
 struct inode {
-	struct list_elem elem;              /* Element in inode list. */
+	struct hash_elem elem;              /* Element in OPEN_INODES. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
 	struct inode_disk data;             /* Inode content. */
+	struct lock lock;                   /* Guards the members below. */
+
+	/* All extents, including those in indirect blocks. */
+	struct extent *exts;                /* DATA.EXTENT_CNT extents. */
+	uint32_t *firsts;                   /* First file sector of each. */
+	size_t ext_cap;                     /* Capacity of the two arrays. */
+	size_t sector_cnt;                  /* Data sectors (clusters) covered. */
+	size_t hint;                        /* Extent of the last lookup. */
+#ifdef EFILESYS
+	size_t run_cnt;                     /* Number of extents. */
+	cluster_t next_clst;                /* Next cluster to cache, 0 if none. */
+	cluster_t resv_start;               /* Clusters reserved for growth. */
+	size_t resv_cnt;
+#endif
 };
 
+/* Returns the extent among the first CNT of INODE that holds
+ * sector IDX of the file (cluster IDX, with FAT).  The extent of the
+ * previous lookup is tried first, then the next one, so sequential
+ * access does not search. */
+static size_t
+find_extent (struct inode *inode, uint32_t idx, size_t cnt) {
+	size_t lo, hi, h;
+
+	for (h = inode->hint; h < inode->hint + 2 && h < cnt; h++)
+		if (idx >= inode->firsts[h]
+				&& idx - inode->firsts[h] < inode->exts[h].length)
+			goto found;
+
+	/* The last extent whose first sector is at most IDX. */
+	lo = 0;
+	hi = cnt;
+	while (hi - lo > 1) {
+		size_t mid = (lo + hi) / 2;
+
+		if (inode->firsts[mid] <= idx)
+			lo = mid;
+		else
+			hi = mid;
+	}
+	h = lo;
+
+found:
+	inode->hint = h;
+	return h;
+}
+
+/* Makes room for CNT extents in INODE's in-memory arrays. */
+static bool
+extents_reserve (struct inode *inode, size_t cnt) {
+	struct extent *exts;
+	uint32_t *firsts;
+	size_t cap;
+
+	if (cnt <= inode->ext_cap)
+		return true;
+	cap = inode->ext_cap ? inode->ext_cap : 8;
+	while (cap < cnt)
+		cap *= 2;
+
+	exts = realloc (inode->exts, cap * sizeof *exts);
+	if (exts == NULL)
+		return false;
+	inode->exts = exts;
+	firsts = realloc (inode->firsts, cap * sizeof *firsts);
+	if (firsts == NULL)
+		return false;
+	inode->firsts = firsts;
+	inode->ext_cap = cap;
+	return true;
+}
+
+static disk_sector_t lookup_sector (struct inode *, off_t pos);
+
+/* Writes zeros to bytes FROM up to TO of INODE's data, whose sectors
+ * must already be allocated.  INODE's lock must be held. */
+static void
+zero_range (struct inode *inode, off_t from, off_t to) {
+	static char zeros[DISK_SECTOR_SIZE];
+
+	while (from < to) {
+		int ofs = from % DISK_SECTOR_SIZE;
+		int chunk = DISK_SECTOR_SIZE - ofs;
+
+		if (chunk > to - from)
+			chunk = to - from;
+		page_cache_write_at (lookup_sector (inode, from), zeros, ofs, chunk);
+		from += chunk;
+	}
+}
+
+#ifdef EFILESYS
+/* With FAT, the extents of an inode cache its cluster chain as runs
+ * of consecutive clusters, so that finding a cluster does not walk
+ * the chain from its start.  The cache holds a prefix of the chain
+ * and is extended lazily, up to the cluster that is looked up. */
+
+/* Adds clusters of INODE's chain to its cache until it covers
+ * cluster number CLST of the file or the chain ends. */
+static bool
+runs_fill (struct inode *inode, size_t clst) {
+	while (inode->sector_cnt <= clst && inode->next_clst != 0) {
+		cluster_t c = inode->next_clst;
+		struct extent *last = inode->run_cnt
+			? &inode->exts[inode->run_cnt - 1] : NULL;
+
+		if (last != NULL && last->start + last->length == c)
+			last->length++;
+		else {
+			if (!extents_reserve (inode, inode->run_cnt + 1))
+				return false;
+			inode->exts[inode->run_cnt].start = c;
+			inode->exts[inode->run_cnt].length = 1;
+			inode->firsts[inode->run_cnt] = inode->sector_cnt;
+			inode->run_cnt++;
+		}
+		inode->sector_cnt++;
+		c = fat_get (c);
+		inode->next_clst = c == EOChain ? 0 : c;
+	}
+	return true;
+}
+
+/* Returns the disk sector that holds byte offset POS of INODE's
+ * data, or -1 if its chain is not that long.  INODE's lock must be
+ * held. */
+static disk_sector_t
+lookup_sector (struct inode *inode, off_t pos) {
+	unsigned int spc = fat_cluster_sectors ();
+	uint32_t sector = pos / DISK_SECTOR_SIZE;
+	uint32_t clst = sector / spc;
+	size_t h;
+
+	if (!runs_fill (inode, clst) || clst >= inode->sector_cnt)
+		return -1;
+
+	h = find_extent (inode, clst, inode->run_cnt);
+	return cluster_to_sector (inode->exts[h].start + (clst - inode->firsts[h]))
+		+ sector % spc;
+}
+
+/* Starts INODE with an empty cache of its chain. */
+static bool
+inode_load (struct inode *inode) {
+	inode->run_cnt = 0;
+	inode->sector_cnt = 0;
+	inode->next_clst = inode->data.start;
+	return true;
+}
+
+/* Clusters reserved at a time for a growing file. */
+#define RESERVE_CLUSTERS 8
+
+/* Extends INODE's cluster chain until it has enough for LENGTH
+ * bytes, and writes the inode back.  The bytes between the old end of
+ * file and OFFSET are zeroed; the caller writes the rest.  Returns
+ * false if the disk is full; the clusters added so far stay in the
+ * chain.
+ *
+ * Clusters come from a run reserved right after the end of the chain
+ * (after the inode, for an empty file), at least RESERVE_CLUSTERS at
+ * a time, so that a file appended to in small writes stays
+ * contiguous even while other files grow. */
+static bool
+inode_grow (struct inode *inode, off_t offset, off_t length) {
+	struct inode_disk *d = &inode->data;
+	unsigned int spc = fat_cluster_sectors ();
+	size_t need = DIV_ROUND_UP (bytes_to_sectors (length), spc);
+	bool success;
+
+	lock_acquire (&inode->lock);
+	success = runs_fill (inode, SIZE_MAX);
+	while (success && inode->sector_cnt < need) {
+		cluster_t last = 0;
+		cluster_t c;
+
+		if (inode->run_cnt > 0)
+			last = inode->exts[inode->run_cnt - 1].start
+				+ inode->exts[inode->run_cnt - 1].length - 1;
+		if (inode->resv_cnt == 0) {
+			size_t want = need - inode->sector_cnt;
+
+			if (want < RESERVE_CLUSTERS)
+				want = RESERVE_CLUSTERS;
+			inode->resv_cnt = fat_reserve (last != 0 ? last
+					: sector_to_cluster (inode->sector), want, &inode->resv_start);
+			if (inode->resv_cnt == 0)
+				break;
+		}
+		c = inode->resv_start++;
+		inode->resv_cnt--;
+		fat_extend_chain (last, c);
+		if (d->start == 0)
+			d->start = c;
+
+		/* The cache covers the whole chain, so C goes at its end. */
+		inode->next_clst = c;
+		success = runs_fill (inode, inode->sector_cnt);
+	}
+	success = success && inode->sector_cnt >= need;
+
+	if (!success && length > (off_t) (inode->sector_cnt * spc * DISK_SECTOR_SIZE))
+		length = inode->sector_cnt * spc * DISK_SECTOR_SIZE;
+	if (d->length < length) {
+		zero_range (inode, d->length, offset < length ? offset : length);
+		d->length = length;
+	}
+	page_cache_write (inode->sector, d);
+	lock_release (&inode->lock);
+	return success;
+}
+
+/* Gives back the clusters INODE has reserved for growth. */
+static void
+inode_unreserve (struct inode *inode) {
+	if (inode->resv_cnt > 0)
+		fat_unreserve (inode->resv_start, inode->resv_cnt);
+	inode->resv_cnt = 0;
+}
+
+/* Frees INODE's cluster chain and drops its cache. */
+static void
+inode_release_data (struct inode *inode) {
+	inode_unreserve (inode);
+	if (inode->data.start != 0)
+		fat_remove_chain (inode->data.start, 0);
+	inode->data.start = 0;
+	inode_load (inode);
+}
+#else
+/* Returns the disk sector that holds byte offset POS of INODE's
+ * data, which must be allocated.  INODE's lock must be held. */
+static disk_sector_t
+lookup_sector (struct inode *inode, off_t pos) {
+	uint32_t idx = pos / DISK_SECTOR_SIZE;
+	size_t h;
+
+	h = find_extent (inode, idx, inode->data.extent_cnt);
+	return inode->exts[h].start + (idx - inode->firsts[h]);
+}
+
+/* Loads INODE's extents from its on-disk inode and indirect blocks. */
+static bool
+inode_load (struct inode *inode) {
+	struct inode_disk *d = &inode->data;
+	struct extent *block = NULL;
+	size_t i;
+
+	if (d->extent_cnt > MAX_EXTENTS || !extents_reserve (inode, d->extent_cnt))
+		return false;
+	for (i = 0; i < d->extent_cnt; i++) {
+		if (i < INODE_EXTENTS)
+			inode->exts[i] = d->extents[i];
+		else {
+			size_t j = (i - INODE_EXTENTS) % BLOCK_EXTENTS;
+
+			if (j == 0) {
+				if (block == NULL)
+					block = malloc (DISK_SECTOR_SIZE);
+				if (block == NULL)
+					return false;
+				page_cache_read (d->indirect[(i - INODE_EXTENTS) / BLOCK_EXTENTS],
+						block);
+			}
+			inode->exts[i] = block[j];
+		}
+		inode->firsts[i] = inode->sector_cnt;
+		inode->sector_cnt += inode->exts[i].length;
+	}
+	free (block);
+	return true;
+}
+
+/* Writes INODE to disk, along with the indirect blocks that hold
+ * extents numbered FROM and above. */
+static void
+extents_store (struct inode *inode, size_t from) {
+	struct inode_disk *d = &inode->data;
+	size_t b;
+
+	for (b = 0; b < INDIRECT_BLOCKS; b++) {
+		size_t first = INODE_EXTENTS + b * BLOCK_EXTENTS;
+		struct extent block[BLOCK_EXTENTS];
+		size_t cnt;
+
+		if (first >= d->extent_cnt)
+			break;
+		if (first + BLOCK_EXTENTS <= from)
+			continue;
+		cnt = d->extent_cnt - first < BLOCK_EXTENTS
+			? d->extent_cnt - first : BLOCK_EXTENTS;
+		memset (block, 0, sizeof block);
+		memcpy (block, inode->exts + first, cnt * sizeof *block);
+		page_cache_write (d->indirect[b], block);
+	}
+
+	memset (d->extents, 0, sizeof d->extents);
+	memcpy (d->extents, inode->exts,
+			(d->extent_cnt < INODE_EXTENTS ? d->extent_cnt : INODE_EXTENTS)
+			* sizeof *d->extents);
+	page_cache_write (inode->sector, d);
+}
+
+/* Allocates data sectors until INODE has enough for LENGTH bytes,
+ * and writes the inode back.  The bytes between the old end of file
+ * and OFFSET are zeroed; the caller writes the rest.  The last extent
+ * grows in place while the sectors following it are free; otherwise
+ * the largest free run that is needed starts a new extent.  Returns
+ * false if the disk or the extent table is full; the sectors
+ * allocated so far stay with the inode. */
+static bool
+inode_grow (struct inode *inode, off_t offset, off_t length) {
+	struct inode_disk *d = &inode->data;
+	size_t need = bytes_to_sectors (length);
+	size_t from;
+	bool success = true;
+
+	lock_acquire (&inode->lock);
+	from = d->extent_cnt ? d->extent_cnt - 1 : 0;
+	while (inode->sector_cnt < need) {
+		size_t cnt = need - inode->sector_cnt;
+		disk_sector_t start;
+
+		if (d->extent_cnt > 0) {
+			struct extent *last = &inode->exts[d->extent_cnt - 1];
+
+			cnt = free_map_extend (last->start + last->length, cnt);
+			if (cnt > 0) {
+				last->length += cnt;
+				inode->sector_cnt += cnt;
+				continue;
+			}
+			cnt = need - inode->sector_cnt;
+		}
+
+		if (d->extent_cnt == MAX_EXTENTS
+				|| !extents_reserve (inode, d->extent_cnt + 1)) {
+			success = false;
+			break;
+		}
+		/* Starting a new indirect block takes a sector too. */
+		if (d->extent_cnt >= INODE_EXTENTS
+				&& (d->extent_cnt - INODE_EXTENTS) % BLOCK_EXTENTS == 0
+				&& !free_map_allocate (1, &d->indirect[(d->extent_cnt
+							- INODE_EXTENTS) / BLOCK_EXTENTS])) {
+			success = false;
+			break;
+		}
+		while (cnt > 0 && !free_map_allocate (cnt, &start))
+			cnt /= 2;
+		if (cnt == 0) {
+			if (d->extent_cnt >= INODE_EXTENTS
+					&& (d->extent_cnt - INODE_EXTENTS) % BLOCK_EXTENTS == 0)
+				free_map_release (d->indirect[(d->extent_cnt - INODE_EXTENTS)
+						/ BLOCK_EXTENTS], 1);
+			success = false;
+			break;
+		}
+		inode->exts[d->extent_cnt].start = start;
+		inode->exts[d->extent_cnt].length = cnt;
+		inode->firsts[d->extent_cnt] = inode->sector_cnt;
+		d->extent_cnt++;
+		inode->sector_cnt += cnt;
+	}
+
+	if (!success && length > (off_t) (inode->sector_cnt * DISK_SECTOR_SIZE))
+		length = inode->sector_cnt * DISK_SECTOR_SIZE;
+	if (d->length < length) {
+		zero_range (inode, d->length, offset < length ? offset : length);
+		d->length = length;
+	}
+	extents_store (inode, from);
+	lock_release (&inode->lock);
+	return success;
+}
+
+/* Frees INODE's data sectors and indirect blocks. */
+static void
+inode_release_data (struct inode *inode) {
+	struct inode_disk *d = &inode->data;
+	size_t i;
+
+	for (i = 0; i < d->extent_cnt; i++)
+		free_map_release (inode->exts[i].start, inode->exts[i].length);
+	for (i = 0; i * BLOCK_EXTENTS + INODE_EXTENTS < d->extent_cnt; i++)
+		free_map_release (d->indirect[i], 1);
+	d->extent_cnt = 0;
+	inode->sector_cnt = 0;
+}
+#endif
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
  * POS. */
 static disk_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) {
+byte_to_sector (struct inode *inode, off_t pos) {
+	disk_sector_t sector = -1;
+
 	ASSERT (inode != NULL);
+	lock_acquire (&inode->lock);
 	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
-	else
-		return -1;
+		sector = lookup_sector (inode, pos);
+	lock_release (&inode->lock);
+	return sector;
 }
 
-/* List of open inodes, so that opening a single inode twice
- * returns the same `struct inode'. */
-static struct list open_inodes;
+/* Open inodes, keyed by sector, so that opening a single inode
+ * twice returns the same `struct inode'.  OPEN_INODES_LOCK guards
+ * the table and every inode's OPEN_CNT, so an inode is never found
+ * after its last inode_close() has begun. */
+static struct hash open_inodes;
+static struct lock open_inodes_lock;
+
+static uint64_t
+inode_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_int (hash_entry (e, struct inode, elem)->sector);
+}
+
+static bool
+inode_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct inode, elem)->sector
+		< hash_entry (b, struct inode, elem)->sector;
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) {
-	list_init (&open_inodes);
+	hash_init (&open_inodes, inode_hash, inode_less, NULL);
+	lock_init (&open_inodes_lock);
+}
+
+/* Frees INODE's memory. */
+static void
+inode_free (struct inode *inode) {
+	free (inode->exts);
+	free (inode->firsts);
+	free (inode);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -67,6 +515,7 @@ inode_init (void) {
 bool
 inode_create (disk_sector_t sector, off_t length) {
 	struct inode_disk *disk_inode = NULL;
+	struct inode *inode;
 	bool success = false;
 
 	ASSERT (length >= 0);
@@ -77,21 +526,18 @@ inode_create (disk_sector_t sector, off_t length) {
 
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
-		size_t sectors = bytes_to_sectors (length);
-		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
-			if (sectors > 0) {
-				static char zeros[DISK_SECTOR_SIZE];
-				size_t i;
-
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
-			}
-			success = true; 
-		} 
+		page_cache_write (sector, disk_inode);
 		free (disk_inode);
+
+		/* Data is allocated the same way a write would grow it. */
+		inode = inode_open (sector);
+		if (inode != NULL) {
+			success = inode_grow (inode, length, length);
+			if (!success)
+				inode_release_data (inode);
+			inode_close (inode);
+		}
 	}
 	return success;
 }
@@ -101,39 +547,58 @@ inode_create (disk_sector_t sector, off_t length) {
  * Returns a null pointer if memory allocation fails. */
 struct inode *
 inode_open (disk_sector_t sector) {
-	struct list_elem *e;
-	struct inode *inode;
+	struct inode key, *inode;
+	struct hash_elem *e;
 
 	/* Check whether this inode is already open. */
-	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-			e = list_next (e)) {
-		inode = list_entry (e, struct inode, elem);
-		if (inode->sector == sector) {
-			inode_reopen (inode);
-			return inode; 
-		}
+	key.sector = sector;
+	lock_acquire (&open_inodes_lock);
+	e = hash_find (&open_inodes, &key.elem);
+	if (e != NULL) {
+		inode = hash_entry (e, struct inode, elem);
+		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+		return inode;
 	}
+	lock_release (&open_inodes_lock);
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = calloc (1, sizeof *inode);
 	if (inode == NULL)
 		return NULL;
 
-	/* Initialize. */
-	list_push_front (&open_inodes, &inode->elem);
+	/* Initialize.  The disk is read without the lock held. */
 	inode->sector = sector;
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	lock_init (&inode->lock);
+	page_cache_read (inode->sector, &inode->data);
+	if (!inode_load (inode)) {
+		inode_free (inode);
+		return NULL;
+	}
+
+	/* Someone else may have opened the inode meanwhile. */
+	lock_acquire (&open_inodes_lock);
+	e = hash_insert (&open_inodes, &inode->elem);
+	if (e != NULL) {
+		inode_free (inode);
+		inode = hash_entry (e, struct inode, elem);
+		inode->open_cnt++;
+	}
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -148,26 +613,53 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
 	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
-		list_remove (&inode->elem);
+	lock_acquire (&open_inodes_lock);
+	last = --inode->open_cnt == 0;
+	if (last)
+		hash_delete (&open_inodes, &inode->elem);
+	lock_release (&open_inodes_lock);
+
+	if (last) {
 
 		/* Deallocate blocks if removed. */
 		if (inode->removed) {
+#ifdef EFILESYS
+			fat_remove_chain (sector_to_cluster (inode->sector), 0);
+#else
 			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
+#endif
+			inode_release_data (inode);
 		}
 
-		free (inode); 
+#ifdef EFILESYS
+		inode_unreserve (inode);
+#endif
+		inode_free (inode);
 	}
 }
 
+/* Stores the number of physically contiguous runs of INODE's data in
+ * *RUNS and the number of sectors (clusters, with FAT) in *BLOCKS. */
+void
+inode_layout (struct inode *inode, size_t *runs, size_t *blocks) {
+	lock_acquire (&inode->lock);
+#ifdef EFILESYS
+	runs_fill (inode, SIZE_MAX);
+	*runs = inode->run_cnt;
+#else
+	*runs = inode->data.extent_cnt;
+#endif
+	*blocks = inode->sector_cnt;
+	lock_release (&inode->lock);
+}
+
 /* Marks INODE to be deleted when it is closed by the last caller who
  * has it open. */
 void
@@ -183,7 +675,6 @@ off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
 
 	while (size > 0) {
 		/* Disk sector to read, starting byte offset within sector. */
@@ -200,46 +691,58 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		page_cache_read_at (sector_idx, buffer + bytes_read, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free (bounce);
 
 	return bytes_read;
 }
 
+/* Starts reading the LENGTH bytes of INODE at OFFSET into the buffer
+ * cache in the background.  With FAT, whole clusters are read. */
+void
+inode_readahead (struct inode *inode, off_t offset, off_t length) {
+	off_t end = offset + length;
+
+#ifdef EFILESYS
+	off_t cluster_size = fat_cluster_sectors () * DISK_SECTOR_SIZE;
+
+	offset = ROUND_DOWN (offset, cluster_size);
+	end = ROUND_UP (end, cluster_size);
+#endif
+	if (end > inode_length (inode))
+		end = inode_length (inode);
+	for (offset = ROUND_DOWN (offset, DISK_SECTOR_SIZE); offset < end;
+			offset += DISK_SECTOR_SIZE) {
+		disk_sector_t sector = byte_to_sector (inode, offset);
+
+		/* Nothing to read where INODE holds no data. */
+		if (sector != (disk_sector_t) -1)
+			page_cache_prefetch (sector);
+	}
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
  * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * less than SIZE if the disk is full or an error occurs.
+ * A write past end of file extends the inode first. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
 
 	if (inode->deny_write_cnt)
 		return 0;
 
+	if (offset + size > inode_length (inode))
+		inode_grow (inode, offset, offset + size);
+
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
 		disk_sector_t sector_idx = byte_to_sector (inode, offset);
@@ -255,34 +758,14 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+		page_cache_write_at (sector_idx, buffer + bytes_written, sector_ofs,
+				chunk_size);
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free (bounce);
 
 	return bytes_written;
 }
@@ -1,5 +1,13 @@
 /* page_cache.c: Implementation of Page Cache (Buffer Cache). */
 
+#include "filesys/page_cache.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
 #include "vm/vm.h"
 static bool page_cache_readahead (struct page *page, void *kva);
 static bool page_cache_writeback (struct page *page);
@@ -15,10 +23,296 @@ static const struct page_operations page_cache_op = {
 
 tid_t page_cache_workerd;
 
-/* The initializer of file vm */
+/* Buffer cache.
+ *
+ * File system sectors are cached in PAGE_CACHE_SIZE entries that are
+ * replaced with the clock algorithm.  Writes only dirty the cached
+ * copy; page_cache_kworkerd syncs the file system every
+ * PAGE_CACHE_FLUSH_MS and page_cache_done() writes the rest at
+ * shutdown.
+ *
+ * Sequential readers queue the sectors they will want next with
+ * page_cache_prefetch(); page_cache_kreadaheadd reads them in the
+ * background, so they are already in flight or cached when asked for.
+ *
+ * CACHE_LOCK guards every entry and the readahead queue.  Disk I/O,
+ * and copies to and from callers' buffers, which may fault in user
+ * pages, run without it: the entry is marked busy meanwhile, and
+ * whoever wants a busy entry waits on CACHE_IO_DONE. */
+#define PAGE_CACHE_SIZE 64
+#define PAGE_CACHE_FLUSH_MS 1000
+#define RA_QUEUE_SIZE 64
+
+struct cache_entry {
+	disk_sector_t sector;           /* Cached sector. */
+	bool used;                      /* Holds a sector? */
+	bool dirty;                     /* Differs from the disk? */
+	bool accessed;                  /* Used since the hand last passed? */
+	bool busy;                      /* Disk I/O or copy in progress? */
+	bool prefetched;                /* Read ahead and not used yet? */
+	uint8_t data[DISK_SECTOR_SIZE];
+};
+
+static struct cache_entry cache[PAGE_CACHE_SIZE];
+static size_t cache_hand;
+static struct lock cache_lock;
+static struct condition cache_io_done;
+
+static long long cache_hit_cnt;     /* Accesses served from the cache. */
+static long long cache_miss_cnt;    /* Accesses that read the disk. */
+static long long cache_wb_cnt;      /* Dirty sectors written back. */
+
+/* Readahead queue, a ring of sectors to read in the background. */
+static disk_sector_t ra_queue[RA_QUEUE_SIZE];
+static size_t ra_head, ra_tail;
+static struct condition ra_queued;
+
+static long long ra_issue_cnt;      /* Sectors read ahead. */
+static long long ra_hit_cnt;        /* Read-ahead sectors used later. */
+static long long ra_waste_cnt;      /* Evicted before being used. */
+
+static void page_cache_kworkerd (void *aux);
+static void page_cache_kreadaheadd (void *aux);
+
+/* The initializer of file vm.  The buffer cache and its worker
+ * daemon are set up by page_cache_init() from filesys_init(). */
 void
 pagecache_init (void) {
-	/* TODO: Create a worker daemon for page cache with page_cache_kworkerd */
+}
+
+/* Initializes the buffer cache and starts the worker daemons that
+ * flush it and read ahead into it. */
+void
+page_cache_init (void) {
+	lock_init (&cache_lock);
+	cond_init (&cache_io_done);
+	cond_init (&ra_queued);
+	page_cache_workerd = thread_create ("page_cache_kworkerd", PRI_DEFAULT,
+			page_cache_kworkerd, NULL);
+	thread_create ("page_cache_kreadaheadd", PRI_DEFAULT,
+			page_cache_kreadaheadd, NULL);
+}
+
+/* Writes dirty entry E back to disk.  Returns with CACHE_LOCK held,
+ * having released it for the I/O. */
+static void
+cache_writeback (struct cache_entry *e) {
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+	ASSERT (e->used && e->dirty && !e->busy);
+
+	e->busy = true;
+	e->dirty = false;
+	lock_release (&cache_lock);
+	disk_write (filesys_disk, e->sector, e->data);
+	lock_acquire (&cache_lock);
+	e->busy = false;
+	cache_wb_cnt++;
+	cond_broadcast (&cache_io_done, &cache_lock);
+}
+
+/* Returns the entry caching SECTOR, or a null pointer. */
+static struct cache_entry *
+cache_find (disk_sector_t sector) {
+	size_t i;
+
+	for (i = 0; i < PAGE_CACHE_SIZE; i++)
+		if (cache[i].used && cache[i].sector == sector)
+			return &cache[i];
+	return NULL;
+}
+
+/* Picks an entry to replace with the clock algorithm, or returns a
+ * null pointer if every entry is busy. */
+static struct cache_entry *
+cache_victim (void) {
+	size_t i;
+
+	for (i = 0; i < 2 * PAGE_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[cache_hand];
+
+		cache_hand = (cache_hand + 1) % PAGE_CACHE_SIZE;
+		if (!e->used)
+			return e;
+		if (e->busy)
+			continue;
+		if (e->accessed)
+			e->accessed = false;
+		else
+			return e;
+	}
+	return NULL;
+}
+
+/* Makes E, a clean or unused entry, hold SECTOR, reading it from
+ * disk if READ is true. */
+static void
+cache_fill (struct cache_entry *e, disk_sector_t sector, bool read) {
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+	ASSERT (!e->busy && !(e->used && e->dirty));
+
+	if (e->used && e->prefetched)
+		ra_waste_cnt++;
+	e->sector = sector;
+	e->used = true;
+	e->dirty = false;
+	e->prefetched = false;
+	if (read) {
+		e->busy = true;
+		lock_release (&cache_lock);
+		disk_read (filesys_disk, sector, e->data);
+		lock_acquire (&cache_lock);
+		e->busy = false;
+		cond_broadcast (&cache_io_done, &cache_lock);
+	}
+}
+
+/* Returns the entry for SECTOR with CACHE_LOCK held, bringing the
+ * sector in if needed.  If READ is false, the caller overwrites the
+ * whole sector, so it is not read from disk. */
+static struct cache_entry *
+cache_get (disk_sector_t sector, bool read) {
+	struct cache_entry *e;
+
+	lock_acquire (&cache_lock);
+	for (;;) {
+		e = cache_find (sector);
+		if (e != NULL) {
+			if (e->busy) {
+				cond_wait (&cache_io_done, &cache_lock);
+				continue;
+			}
+			if (e->prefetched) {
+				e->prefetched = false;
+				ra_hit_cnt++;
+			}
+			cache_hit_cnt++;
+			break;
+		}
+
+		e = cache_victim ();
+		if (e == NULL) {
+			cond_wait (&cache_io_done, &cache_lock);
+			continue;
+		}
+		if (e->used && e->dirty) {
+			/* SECTOR may be brought in while this is written. */
+			cache_writeback (e);
+			continue;
+		}
+
+		cache_fill (e, sector, read);
+		cache_miss_cnt++;
+		break;
+	}
+	e->accessed = true;
+	return e;
+}
+
+/* Like cache_get(), but returns the entry marked busy and without
+ * CACHE_LOCK, so its data can be copied while the lock is free.
+ * cache_unpin() releases the entry. */
+static struct cache_entry *
+cache_pin (disk_sector_t sector, bool read) {
+	struct cache_entry *e = cache_get (sector, read);
+
+	e->busy = true;
+	lock_release (&cache_lock);
+	return e;
+}
+
+/* Releases E, pinned by cache_pin(), marking it dirty if DIRTY. */
+static void
+cache_unpin (struct cache_entry *e, bool dirty) {
+	lock_acquire (&cache_lock);
+	ASSERT (e->busy);
+	e->busy = false;
+	if (dirty)
+		e->dirty = true;
+	cond_broadcast (&cache_io_done, &cache_lock);
+	lock_release (&cache_lock);
+}
+
+/* Reads SIZE bytes at offset OFS of SECTOR into BUFFER. */
+void
+page_cache_read_at (disk_sector_t sector, void *buffer, int ofs, int size) {
+	struct cache_entry *e;
+
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	e = cache_pin (sector, true);
+	memcpy (buffer, e->data + ofs, size);
+	cache_unpin (e, false);
+}
+
+/* Writes SIZE bytes from BUFFER at offset OFS of SECTOR. */
+void
+page_cache_write_at (disk_sector_t sector, const void *buffer, int ofs,
+		int size) {
+	struct cache_entry *e;
+
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	e = cache_pin (sector, size < DISK_SECTOR_SIZE);
+	memcpy (e->data + ofs, buffer, size);
+	cache_unpin (e, true);
+}
+
+/* Reads SECTOR into BUFFER, which must be DISK_SECTOR_SIZE bytes. */
+void
+page_cache_read (disk_sector_t sector, void *buffer) {
+	page_cache_read_at (sector, buffer, 0, DISK_SECTOR_SIZE);
+}
+
+/* Writes BUFFER, DISK_SECTOR_SIZE bytes, to SECTOR. */
+void
+page_cache_write (disk_sector_t sector, const void *buffer) {
+	page_cache_write_at (sector, buffer, 0, DISK_SECTOR_SIZE);
+}
+
+/* Queues SECTOR to be read in the background.  Does nothing if it is
+ * already cached or the queue is full. */
+void
+page_cache_prefetch (disk_sector_t sector) {
+	lock_acquire (&cache_lock);
+	if (cache_find (sector) == NULL && ra_head - ra_tail < RA_QUEUE_SIZE) {
+		ra_queue[ra_head++ % RA_QUEUE_SIZE] = sector;
+		cond_signal (&ra_queued, &cache_lock);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Writes every dirty sector back to disk. */
+void
+page_cache_flush (void) {
+	size_t i;
+
+	lock_acquire (&cache_lock);
+	for (i = 0; i < PAGE_CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+
+		while (e->busy)
+			cond_wait (&cache_io_done, &cache_lock);
+		if (e->used && e->dirty)
+			cache_writeback (e);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Writes back the buffer cache at shutdown. */
+void
+page_cache_done (void) {
+	page_cache_flush ();
+}
+
+/* Prints buffer cache statistics. */
+void
+page_cache_print_stats (void) {
+	printf ("Buffer cache: %lld hits, %lld misses, %lld writebacks\n",
+			cache_hit_cnt, cache_miss_cnt, cache_wb_cnt);
+	printf ("Buffer cache readahead: %lld sectors, %lld%% hit, %lld%% wasted\n",
+			ra_issue_cnt,
+			ra_issue_cnt ? ra_hit_cnt * 100 / ra_issue_cnt : 0,
+			ra_issue_cnt ? ra_waste_cnt * 100 / ra_issue_cnt : 0);
 }
 
 /* Initialize the page cache */
@@ -44,7 +338,45 @@ static void
 page_cache_destroy (struct page *page) {
 }
 
-/* Worker thread for page cache */
+/* Worker thread for page cache: syncs the file system periodically,
+ * so that a crash loses little and replacement rarely has to wait for
+ * a write.  Changed FAT and free map sectors are written here too. */
 static void
-page_cache_kworkerd (void *aux) {
+page_cache_kworkerd (void *aux UNUSED) {
+	for (;;) {
+		timer_msleep (PAGE_CACHE_FLUSH_MS);
+		filesys_sync ();
+	}
+}
+
+/* Readahead thread for page cache: reads the queued sectors into the
+ * cache, one at a time, in the order they were queued. */
+static void
+page_cache_kreadaheadd (void *aux UNUSED) {
+	lock_acquire (&cache_lock);
+	for (;;) {
+		disk_sector_t sector;
+
+		while (ra_head == ra_tail)
+			cond_wait (&ra_queued, &cache_lock);
+		sector = ra_queue[ra_tail++ % RA_QUEUE_SIZE];
+
+		while (cache_find (sector) == NULL) {
+			struct cache_entry *e = cache_victim ();
+
+			if (e == NULL)
+				cond_wait (&cache_io_done, &cache_lock);
+			else if (e->used && e->dirty)
+				cache_writeback (e);
+			else {
+				/* Readers that waited for the I/O still hold off
+				 * until the lock is released, after this marking. */
+				cache_fill (e, sector, true);
+				e->prefetched = true;
+				e->accessed = true;
+				ra_issue_cnt++;
+				break;
+			}
+		}
+	}
 }
@@ -0,0 +1,21 @@
+#ifndef FILESYS_DENTRY_H
+#define FILESYS_DENTRY_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+
+/* Child sector of a negative entry: the name is known to be absent. */
+#define DENTRY_NONE ((disk_sector_t) -1)
+
+void dentry_init (void);
+bool dentry_lookup (disk_sector_t parent, const char *name,
+		disk_sector_t *sectorp);
+void dentry_insert (disk_sector_t parent, const char *name,
+		disk_sector_t sector);
+unsigned dentry_generation (void);
+void dentry_fill (disk_sector_t parent, const char *name,
+		disk_sector_t sector, unsigned generation);
+void dentry_purge (disk_sector_t parent);
+void dentry_print_stats (void);
+
+#endif /* filesys/dentry.h */
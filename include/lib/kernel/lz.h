@@ -0,0 +1,28 @@
+#ifndef __LIB_KERNEL_LZ_H
+#define __LIB_KERNEL_LZ_H
+
+/* LZ77-family block compressor.
+ *
+ * The format is a sequence of (literals, match) pairs in the style
+ * of LZ4: a token byte holding the literal run length in its high
+ * nibble and the match length minus LZ_MIN_MATCH in its low nibble,
+ * with 255-valued extension bytes for either nibble that reads 15,
+ * then the literals, then a 16-bit little-endian match offset.  The
+ * last pair has no match.  Blocks must not exceed 64 kB. */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Shortest match that is encoded. */
+#define LZ_MIN_MATCH 4
+
+/* Bytes of scratch memory lz_compress() needs. */
+#define LZ_HASH_BITS 12
+#define LZ_WORK_SIZE ((1 << LZ_HASH_BITS) * sizeof (uint16_t))
+
+size_t lz_compress (const void *src, size_t src_len,
+		void *dst, size_t dst_cap, void *work);
+size_t lz_decompress (const void *src, size_t src_len,
+		void *dst, size_t dst_cap);
+
+#endif /* lib/kernel/lz.h */
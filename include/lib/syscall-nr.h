@@ -36,6 +36,50 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* Extra for Project 3 */
+	SYS_MADVISE,                /* Give advice about use of memory. */
+	SYS_FAULTSTAT,              /* Reads page fault statistics. */
+	SYS_SPAWN,                  /* Start a new process from a program. */
+};
+
+/* Advice for SYS_MADVISE. */
+enum {
+	MADV_NORMAL,                /* No particular access pattern. */
+	MADV_RANDOM,                /* Random access; no readahead. */
+	MADV_SEQUENTIAL,            /* Sequential access; read ahead widely. */
+	MADV_WILLNEED,              /* Will be used soon; bring it in now. */
+	MADV_DONTNEED,              /* Not needed for now; drop it. */
+};
+
+/* Page fault causes, as counted for SYS_FAULTSTAT. */
+enum fault_cause {
+	FAULT_LAZY,                 /* Lazy load from an executable or file. */
+	FAULT_ZERO,                 /* Anonymous zero-fill. */
+	FAULT_STACK,                /* Stack growth. */
+	FAULT_SWAP,                 /* Swap-in of an anonymous page. */
+	FAULT_COW,                  /* Write to a copy-on-write page. */
+	FAULT_INVALID,              /* Not handled; the faulting process dies. */
+	FAULT_CAUSE_CNT
+};
+
+/* Latency histogram buckets: bucket I counts faults that took
+   [2**I, 2**(I+1)) TSC cycles. */
+#define FAULT_HIST_BUCKETS 32
+
+/* Page fault statistics filled in by SYS_FAULTSTAT. */
+struct fault_stats {
+	long long cnt[FAULT_CAUSE_CNT];     /* Faults per cause. */
+	long long cycles[FAULT_CAUSE_CNT];  /* Total TSC cycles per cause. */
+	long long hist[FAULT_CAUSE_CNT][FAULT_HIST_BUCKETS];
+};
+
+/* A file descriptor to pass to a process started by SYS_SPAWN:
+   the child gets the parent's FD as CHILD_FD.  A list of actions
+   ends with an entry whose FD is -1. */
+struct spawn_fd_action {
+	int fd;
+	int child_fd;
 };
 
 #endif /* lib/syscall-nr.h */
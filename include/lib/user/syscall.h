@@ -25,6 +25,8 @@ void halt (void) NO_RETURN;
 void exit (int status) NO_RETURN;
 pid_t fork (const char *thread_name);
 int exec (const char *file);
+struct spawn_fd_action;
+pid_t spawn (const char *cmd_line, const struct spawn_fd_action *fd_actions);
 int wait (pid_t);
 bool create (const char *file, unsigned initial_size);
 bool remove (const char *file);
@@ -41,6 +43,9 @@ int dup2(int oldfd, int newfd);
 /* Project 3 and optionally project 4. */
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
+int madvise (void *addr, size_t length, int advice);
+struct fault_stats;
+bool faultstat (struct fault_stats *stats, bool all);
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -72,10 +72,14 @@ struct thread {
 #ifdef USERPROG
 	/* userprog/process.c에서 사용 */
 	uint64_t *pml4;                     /* 4단계 페이지 맵 */
+	struct file *running_file;          /* 실행 중인 실행 파일 */
+	struct fault_stats *fault_stats;    /* 페이지 폴트 통계 (첫 폴트 때 할당) */
 #endif
 #ifdef VM
 	/* 스레드가 소유하는 전체 가상 메모리 테이블 */
 	struct supplemental_page_table spt;
+	void *user_rsp;                     /* 시스템 콜 진입 시의 유저 rsp (스택 확장용) */
+	int fault_cause;                    /* 처리한 페이지 폴트의 원인 (enum fault_cause) */
 #endif
 
 	/* thread.c에서 사용 */
@@ -6,7 +6,14 @@
 #define PF_W 0x2    /* 0: read, 1: write. */
 #define PF_U 0x4    /* 0: kernel, 1: user process. */
 
+#include <stdbool.h>
+
+struct thread;
+struct fault_stats;
+
 void exception_init (void);
 void exception_print_stats (void);
+void exception_get_fault_stats (struct fault_stats *, bool all);
+void exception_release_fault_stats (struct thread *);
 
 #endif /* userprog/exception.h */
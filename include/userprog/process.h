@@ -5,6 +5,9 @@
 
 tid_t process_create_initd (const char *file_name);
 tid_t process_fork (const char *name, struct intr_frame *if_);
+struct spawn_fd_action;
+tid_t process_spawn (const char *cmd_line,
+		const struct spawn_fd_action *fd_actions);
 int process_exec (void *f_name);
 int process_wait (tid_t);
 void process_exit (void);
@@ -2,12 +2,36 @@
 #define VM_ANON_H
 #include "vm/vm.h"
 struct page;
+struct zswap_entry;
 enum vm_type;
 
+#include <stddef.h>
+
+/* Swap slot value of a page that is not on the swap disk. */
+#define SWAP_SLOT_NONE ((size_t) -1)
+
 struct anon_page {
+	enum vm_type type;      /* VM_ANON and the markers it was made with. */
+	size_t slot;            /* Swap slot holding the page, or SWAP_SLOT_NONE. */
+	struct zswap_entry *zswap;  /* Compressed copy in memory, if any. */
+	bool readahead;         /* Being brought in on behalf of a neighbour. */
+
+	/* Lazy loader that first filled the page, kept so that
+	 * MADV_DONTNEED can start the page over from it.  INIT is null
+	 * for a page that started out zeroed. */
+	vm_initializer *init;
+	void *aux;              /* Owned copy of the loader's aux. */
+	size_t aux_size;
 };
 
+/* Size of the compressed swap pool in bytes, 0 to disable it. */
+extern size_t zswap_pool_limit;
+
 void vm_anon_init (void);
+void vm_anon_print_stats (void);
 bool anon_initializer (struct page *page, enum vm_type type, void *kva);
+void anon_swap_cluster_begin (size_t page_cnt);
+void anon_swap_cluster_end (void);
+bool anon_swap_dup (struct page *dst, struct page *src);
 
 #endif
@@ -6,11 +6,37 @@
 struct page;
 enum vm_type;
 
+/* A region of a file mapped by do_mmap() or by the ELF loader.  Every
+ * page of the region, in the mapping process and in its forks, holds a
+ * reference. */
+struct mmap_file {
+	struct file *file;      /* Private handle on the mapped file. */
+	void *addr;             /* First page of the region. */
+	size_t page_cnt;        /* Length of the region in pages. */
+	int ref_cnt;            /* Pages referring to this region. */
+	bool readahead;         /* Track the access pattern? */
+	bool mmapped;           /* Made by mmap(), so munmap() may remove it? */
+
+	/* Readahead state, see vm_mmap_readahead(). */
+	void *ra_next;          /* Page a sequential scan faults on next. */
+	size_t ra_size;         /* Current window in pages, 0 if random. */
+	void *ra_marker;        /* Page whose access starts the next window. */
+};
+
 struct file_page {
+	struct file *file;      /* Backing file. */
+	off_t offset;           /* Offset of the page within FILE. */
+	size_t read_bytes;      /* Bytes backed by FILE; the rest is zero. */
+	struct mmap_file *map;  /* Region this page belongs to, if mmapped. */
 };
 
 void vm_file_init (void);
+void vm_file_print_stats (void);
 bool file_backed_initializer (struct page *page, enum vm_type type, void *kva);
+void file_backed_dup (struct page *page);
+void file_writeback (struct page **pages, size_t cnt);
+bool file_map (void *addr, size_t page_cnt, bool writable, struct file *file,
+		off_t offset, size_t read_bytes, bool readahead);
 void *do_mmap(void *addr, size_t length, int writable,
 		struct file *file, off_t offset);
 void do_munmap (void *va);
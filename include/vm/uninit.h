@@ -14,6 +14,7 @@ struct uninit_page {
 	vm_initializer *init;
 	enum vm_type type;
 	void *aux;
+	size_t aux_size;    /* Bytes at AUX, so fork can copy it; 0 if unknown. */
 	/* Initiate the struct page and maps the pa to the va */
 	bool (*page_initializer) (struct page *, enum vm_type, void *kva);
 };
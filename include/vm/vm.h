@@ -1,6 +1,8 @@
 #ifndef VM_VM_H
 #define VM_VM_H
 #include <stdbool.h>
+#include <hash.h>
+#include <list.h>
 #include "threads/palloc.h"
 
 enum vm_type {
@@ -24,6 +26,9 @@ enum vm_type {
 	VM_MARKER_END = (1 << 31),
 };
 
+/* Marks the pages that make up the user stack. */
+#define VM_STACK VM_MARKER_0
+
 #include "vm/uninit.h"
 #include "vm/anon.h"
 #include "vm/file.h"
@@ -46,6 +51,11 @@ struct page {
 	struct frame *frame;   /* Back reference for frame */
 
 	/* Your implementation */
+	struct hash_elem spt_elem;     /* Element in the owner's spt. */
+	struct list_elem mapper_elem;  /* Element in frame->mappers. */
+	struct thread *owner;          /* Thread whose pml4 maps VA. */
+	bool writable;                 /* May the user write to this page? */
+	unsigned char advice;          /* MADV_* access pattern, see madvise. */
 
 	/* Per-type data are binded into the union.
 	 * Each function automatically detects the current union */
@@ -63,6 +73,25 @@ struct page {
 struct frame {
 	void *kva;
 	struct page *page;
+
+	struct list_elem elem;         /* Element in the global frame table. */
+	struct list mappers;           /* Pages whose PTE points at KVA. */
+	bool pinned;                   /* Must not be chosen for eviction. */
+	bool evicting;                 /* Being written out by an evictor. */
+
+	/* Page cache: a frame holding a page of a file is found by the
+	 * (INODE, OFFSET) it holds, so it can be shared by every process
+	 * that maps the page.  INODE is NULL if the frame is not cached. */
+	struct hash_elem cache_elem;   /* Element in the page cache. */
+	struct inode *inode;           /* Inode the contents come from. */
+	off_t offset;                  /* Offset of the page in INODE. */
+	size_t read_bytes;             /* Bytes from INODE; the rest is zero. */
+
+	/* Same-page merging: anonymous frames are listed by a checksum of
+	 * their contents, see ksmd(). */
+	struct hash_elem ksm_elem;     /* Element in the KSM table. */
+	unsigned ksm_sum;              /* Checksum when it was listed. */
+	bool ksm_listed;               /* In the KSM table? */
 };
 
 /* The function table for page operations.
@@ -85,6 +114,7 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
+	struct hash pages;             /* struct page, keyed by va. */
 };
 
 #include "threads/thread.h"
@@ -97,7 +127,20 @@ struct page *spt_find_page (struct supplemental_page_table *spt,
 bool spt_insert_page (struct supplemental_page_table *spt, struct page *page);
 void spt_remove_page (struct supplemental_page_table *spt, struct page *page);
 
+/* Pages brought in around a fault on file-backed memory, from 1
+ * (off) up to FAULT_AROUND_MAX. */
+extern size_t vm_fault_around_pages;
+#define FAULT_AROUND_MAX 32
+
+/* Largest size the user stack may grow to, in bytes. */
+extern size_t vm_stack_limit;
+
+/* Same-page merging scan rate, see ksmd(); 0 pages turns it off. */
+extern size_t ksm_pages_to_scan;
+extern unsigned ksm_sleep_ms;
+
 void vm_init (void);
+void vm_print_stats (void);
 bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 		bool write, bool not_present);
 
@@ -106,7 +149,12 @@ bool vm_try_handle_fault (struct intr_frame *f, void *addr, bool user,
 bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
+void vm_unlink_frame (struct page *page);
 bool vm_claim_page (void *va);
+bool vm_try_claim_page (struct page *page);
+bool vm_pin_dirty_page (struct page *page);
+void vm_unpin_page (struct page *page);
+int vm_madvise (void *addr, size_t length, int advice);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
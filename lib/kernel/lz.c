@@ -0,0 +1,171 @@
+#include "lz.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Reads 4 possibly unaligned bytes at P. */
+static inline uint32_t
+read32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+/* Returns the hash table slot for the 4 bytes V. */
+static inline size_t
+hash32 (uint32_t v) {
+	return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Writes the extension bytes for a length LEN whose nibble was
+   saturated at 15, at OP.  Returns the new output position, or a
+   null pointer if that would pass END. */
+static uint8_t *
+put_length (uint8_t *op, uint8_t *end, size_t len) {
+	for (len -= 15; ; len -= 255) {
+		if (op >= end)
+			return NULL;
+		if (len < 255) {
+			*op++ = len;
+			return op;
+		}
+		*op++ = 255;
+	}
+}
+
+/* Reads the extension bytes of a length whose nibble was 15 from
+   *IPP, which must stay below END, and adds them to *LEN.  Returns
+   false if the input ends first. */
+static bool
+get_length (const uint8_t **ipp, const uint8_t *end, size_t *len) {
+	const uint8_t *ip = *ipp;
+	uint8_t b;
+
+	do {
+		if (ip >= end)
+			return false;
+		b = *ip++;
+		*len += b;
+	} while (b == 255);
+	*ipp = ip;
+	return true;
+}
+
+/* Appends one sequence to OP: the LIT_LEN literals at LIT, then, if
+   MATCH_LEN is nonzero, a match of that length at distance OFFSET.
+   Returns the new output position, or a null pointer if the
+   sequence does not fit before END. */
+static uint8_t *
+put_sequence (uint8_t *op, uint8_t *end, const uint8_t *lit, size_t lit_len,
+		size_t match_len, size_t offset) {
+	uint8_t *token;
+	size_t ml = match_len ? match_len - LZ_MIN_MATCH : 0;
+
+	if (op >= end)
+		return NULL;
+	token = op++;
+	*token = (lit_len < 15 ? lit_len : 15) << 4;
+	if (lit_len >= 15 && (op = put_length (op, end, lit_len)) == NULL)
+		return NULL;
+	if ((size_t) (end - op) < lit_len)
+		return NULL;
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+
+	if (match_len == 0)
+		return op;
+	if (end - op < 2)
+		return NULL;
+	*op++ = offset & 0xff;
+	*op++ = offset >> 8;
+	*token |= ml < 15 ? ml : 15;
+	if (ml >= 15)
+		op = put_length (op, end, ml);
+	return op;
+}
+
+/* Compresses SRC_LEN bytes at SRC into the DST_CAP bytes at DST,
+   using the LZ_WORK_SIZE bytes at WORK as scratch space.  Returns
+   the compressed size, or 0 if the result does not fit in DST_CAP
+   bytes, which callers use to reject incompressible data early. */
+size_t
+lz_compress (const void *src_, size_t src_len,
+		void *dst_, size_t dst_cap, void *work) {
+	const uint8_t *src = src_;
+	const uint8_t *ip = src, *anchor = src;
+	const uint8_t *end = src + src_len;
+	uint8_t *dst = dst_, *op = dst, *op_end = dst + dst_cap;
+	uint16_t *table = work;
+
+	ASSERT (src_len <= 0x10000);
+
+	memset (table, 0, LZ_WORK_SIZE);
+	while (end - ip >= LZ_MIN_MATCH) {
+		uint32_t seq = read32 (ip);
+		size_t h = hash32 (seq);
+		const uint8_t *ref = src + table[h];
+		const uint8_t *mp, *rp;
+
+		table[h] = ip - src;
+		if (ref >= ip || ip - ref > 0xffff || read32 (ref) != seq) {
+			ip++;
+			continue;
+		}
+
+		for (mp = ip + LZ_MIN_MATCH, rp = ref + LZ_MIN_MATCH;
+				mp < end && *mp == *rp; mp++, rp++)
+			continue;
+
+		op = put_sequence (op, op_end, anchor, ip - anchor, mp - ip, ip - ref);
+		if (op == NULL)
+			return 0;
+		ip = anchor = mp;
+	}
+
+	op = put_sequence (op, op_end, anchor, end - anchor, 0, 0);
+	return op != NULL ? (size_t) (op - dst) : 0;
+}
+
+/* Decompresses the SRC_LEN bytes at SRC into the DST_CAP bytes at
+   DST.  Returns the decompressed size, or 0 if SRC is malformed or
+   would overflow DST. */
+size_t
+lz_decompress (const void *src_, size_t src_len, void *dst_, size_t dst_cap) {
+	const uint8_t *ip = src_, *ip_end = ip + src_len;
+	uint8_t *dst = dst_, *op = dst, *op_end = dst + dst_cap;
+
+	while (ip < ip_end) {
+		uint8_t token = *ip++;
+		size_t lit_len = token >> 4;
+		size_t match_len = token & 15;
+		size_t offset;
+
+		if (lit_len == 15 && !get_length (&ip, ip_end, &lit_len))
+			return 0;
+		if (lit_len > (size_t) (ip_end - ip) || lit_len > (size_t) (op_end - op))
+			return 0;
+		memcpy (op, ip, lit_len);
+		ip += lit_len;
+		op += lit_len;
+
+		/* The last sequence carries literals only. */
+		if (ip == ip_end)
+			break;
+
+		if (ip_end - ip < 2)
+			return 0;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (match_len == 15 && !get_length (&ip, ip_end, &match_len))
+			return 0;
+		match_len += LZ_MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| match_len > (size_t) (op_end - op))
+			return 0;
+
+		/* Byte by byte: the match may overlap its own output. */
+		for (; match_len > 0; match_len--, op++)
+			*op = op[-offset];
+	}
+	return op - dst;
+}
@@ -90,6 +90,11 @@ exec (const char *file) {
 	return (pid_t) syscall1 (SYS_EXEC, file);
 }
 
+pid_t
+spawn (const char *cmd_line, const struct spawn_fd_action *fd_actions) {
+	return (pid_t) syscall2 (SYS_SPAWN, cmd_line, fd_actions);
+}
+
 int
 wait (pid_t pid) {
 	return syscall1 (SYS_WAIT, pid);
@@ -155,6 +160,16 @@ munmap (void *addr) {
 	syscall1 (SYS_MUNMAP, addr);
 }
 
+int
+madvise (void *addr, size_t length, int advice) {
+	return syscall3 (SYS_MADVISE, addr, length, advice);
+}
+
+bool
+faultstat (struct fault_stats *stats, bool all) {
+	return syscall2 (SYS_FAULTSTAT, stats, all);
+}
+
 bool
 chdir (const char *dir) {
 	return syscall1 (SYS_CHDIR, dir);
@@ -0,0 +1,45 @@
+/* Writes a file small enough to fit in the buffer cache, reads it
+   once, and checks that reading it a second time does not touch the
+   disk.
+
+   This cannot run yet: syscall_handler does not implement the file
+   system calls, and nothing handles the get_fs_disk_read_cnt()
+   interrupt. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE (16 * 1024)
+
+static const char file_name[] = "data";
+static char buf[TEST_SIZE];
+static char back[TEST_SIZE];
+
+void
+test_main (void)
+{
+  long long read_cnt;
+  int fd;
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == TEST_SIZE, "write \"%s\"", file_name);
+
+  seek (fd, 0);
+  CHECK (read (fd, back, sizeof back) == TEST_SIZE, "read \"%s\"", file_name);
+  compare_bytes (back, buf, sizeof buf, 0, file_name);
+
+  read_cnt = get_fs_disk_read_cnt ();
+  seek (fd, 0);
+  CHECK (read (fd, back, sizeof back) == TEST_SIZE, "read \"%s\" again",
+         file_name);
+  compare_bytes (back, buf, sizeof buf, 0, file_name);
+  CHECK (get_fs_disk_read_cnt () == read_cnt,
+         "second read is served from the cache");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
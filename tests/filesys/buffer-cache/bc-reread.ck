@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-reread) begin
+(bc-reread) create "data"
+(bc-reread) open "data"
+(bc-reread) write "data"
+(bc-reread) read "data"
+(bc-reread) read "data" again
+(bc-reread) second read is served from the cache
+(bc-reread) close "data"
+(bc-reread) end
+EOF
+pass;
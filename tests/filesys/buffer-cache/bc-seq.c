@@ -0,0 +1,51 @@
+/* Writes a file larger than the buffer cache, then reads it back
+   sequentially, one sector at a time.  The data must match, and with
+   readahead running in the background each sector should still come
+   off the disk about once.
+
+   This cannot run yet: syscall_handler does not implement the file
+   system calls, and nothing handles the get_fs_disk_read_cnt()
+   interrupt. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 512
+#define BLOCK_CNT 96
+#define TEST_SIZE (BLOCK_SIZE * BLOCK_CNT)
+
+static const char file_name[] = "data";
+static char buf[TEST_SIZE];
+
+void
+test_main (void)
+{
+  long long read_cnt;
+  char block[BLOCK_SIZE];
+  size_t i;
+  int fd;
+
+  CHECK (create (file_name, sizeof buf), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  CHECK (write (fd, buf, sizeof buf) == TEST_SIZE, "write \"%s\"", file_name);
+  close (fd);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\" again", file_name);
+  read_cnt = get_fs_disk_read_cnt ();
+  msg ("read \"%s\" sequentially", file_name);
+  for (i = 0; i < BLOCK_CNT; i++)
+    {
+      if (read (fd, block, BLOCK_SIZE) != BLOCK_SIZE)
+        fail ("read of block %zu failed", i);
+      compare_bytes (block, buf + i * BLOCK_SIZE, BLOCK_SIZE,
+                     i * BLOCK_SIZE, file_name);
+    }
+  CHECK (get_fs_disk_read_cnt () - read_cnt <= BLOCK_CNT + BLOCK_CNT / 4,
+         "each sector is read about once");
+
+  msg ("close \"%s\"", file_name);
+  close (fd);
+}
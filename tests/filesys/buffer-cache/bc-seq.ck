@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(bc-seq) begin
+(bc-seq) create "data"
+(bc-seq) open "data"
+(bc-seq) write "data"
+(bc-seq) open "data" again
+(bc-seq) read "data" sequentially
+(bc-seq) each sector is read about once
+(bc-seq) close "data"
+(bc-seq) end
+EOF
+pass;
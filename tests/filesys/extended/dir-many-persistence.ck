@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (%d);
+$d{"f$_"} = [''] foreach 0...39;
+check_archive (\%d);
+pass;
@@ -0,0 +1,62 @@
+/* Creates enough files in the root directory that it must switch
+   to the hashed format, then checks that every file can still be
+   looked up and that readdir() returns each name exactly once. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+
+void
+test_main (void) 
+{
+  char name[READDIR_MAX_LEN + 1];
+  bool seen[FILE_CNT];
+  int dir_fd;
+  int i;
+
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+
+  msg ("open each file");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "f%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+
+  CHECK ((dir_fd = open ("/")) > 1, "open \"/\"");
+  msg ("read \"/\"");
+  for (i = 0; i < FILE_CNT; i++)
+    seen[i] = false;
+  while (readdir (dir_fd, name)) 
+    {
+      int n = atoi (name + 1);
+
+      /* Skip the test program and tar. */
+      if (name[0] != 'f')
+        continue;
+      if (n < 0 || n >= FILE_CNT)
+        fail ("readdir returned unexpected name \"%s\"", name);
+      if (seen[n])
+        fail ("readdir returned \"%s\" twice", name);
+      seen[n] = true;
+    }
+  for (i = 0; i < FILE_CNT; i++)
+    if (!seen[i])
+      fail ("readdir did not return \"f%d\"", i);
+  msg ("close \"/\"");
+  close (dir_fd);
+}
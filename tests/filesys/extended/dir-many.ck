@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-many) begin
+(dir-many) create 40 files
+(dir-many) open each file
+(dir-many) open "/"
+(dir-many) read "/"
+(dir-many) close "/"
+(dir-many) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Looks up a name before it exists, creates it, removes it and
+   creates it again, looking it up after each step.  Every lookup
+   must see the latest state of the directory.
+
+   This cannot run yet: syscall_handler does not implement the file
+   system calls. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static void
+write_file (const char *name, const char *data) 
+{
+  int fd;
+
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  CHECK (write (fd, data, strlen (data)) == (int) strlen (data),
+         "write \"%s\" to \"%s\"", data, name);
+  msg ("close \"%s\"", name);
+  close (fd);
+}
+
+void
+test_main (void) 
+{
+  static const char second[] = "second";
+  char buf[sizeof second];
+  int fd;
+
+  CHECK (open ("x") == -1, "open \"x\" (must fail)");
+  CHECK (create ("x", 0), "create \"x\"");
+  write_file ("x", "first");
+  CHECK (remove ("x"), "remove \"x\"");
+  CHECK (open ("x") == -1, "open \"x\" (must fail)");
+  CHECK (create ("x", 0), "create \"x\" again");
+  write_file ("x", second);
+
+  CHECK ((fd = open ("x")) > 1, "open \"x\" for verification");
+  CHECK (filesize (fd) == (int) strlen (second), "check size of \"x\"");
+  CHECK (read (fd, buf, strlen (second)) == (int) strlen (second),
+         "read \"x\"");
+  compare_bytes (buf, second, strlen (second), 0, "x");
+  msg ("close \"x\"");
+  close (fd);
+}
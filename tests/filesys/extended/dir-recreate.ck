@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-recreate) begin
+(dir-recreate) open "x" (must fail)
+(dir-recreate) create "x"
+(dir-recreate) open "x"
+(dir-recreate) write "first" to "x"
+(dir-recreate) close "x"
+(dir-recreate) remove "x"
+(dir-recreate) open "x" (must fail)
+(dir-recreate) create "x" again
+(dir-recreate) open "x"
+(dir-recreate) write "second" to "x"
+(dir-recreate) close "x"
+(dir-recreate) open "x" for verification
+(dir-recreate) check size of "x"
+(dir-recreate) read "x"
+(dir-recreate) close "x"
+(dir-recreate) end
+EOF
+pass;
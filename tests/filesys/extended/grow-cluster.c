@@ -0,0 +1,9 @@
+/* Grows a file from 0 bytes to 40,000 bytes, 1,234 bytes at a
+   time, on a disk formatted with 8 sectors per cluster, so that
+   writes start and end in the middle of clusters.
+
+   This cannot run yet: syscall_handler does not implement the file
+   system calls. */
+
+#define TEST_SIZE 40000
+#include "tests/filesys/extended/grow-seq.inc"
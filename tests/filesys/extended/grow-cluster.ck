@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+use tests::random;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-cluster) begin
+(grow-cluster) create "testme"
+(grow-cluster) open "testme"
+(grow-cluster) writing "testme"
+(grow-cluster) close "testme"
+(grow-cluster) open "testme" for verification
+(grow-cluster) verified contents of "testme"
+(grow-cluster) close "testme"
+(grow-cluster) end
+EOF
+pass;
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($data) = "\0" x 30000;
+substr ($data, 0, 100) = "x" x 100;
+substr ($data, 700, 50) = "x" x 50;
+substr ($data, 5000, 1234) = "x" x 1234;
+substr ($data, 12345, 1) = "x";
+substr ($data, 29000, 1000) = "x" x 1000;
+check_archive ({"testfile" => [$data]});
+pass;
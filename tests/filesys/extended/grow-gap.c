@@ -0,0 +1,50 @@
+/* Fills the disk's free sectors with junk, then grows a file by
+   writing short runs well past its end, some starting and ending in
+   the middle of a sector.  Everything between the runs must read
+   back as zeros, including the ends of sectors that lay past the end
+   of file before the next write. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char junk[32768];
+static char buf[30000];
+
+static const struct
+  {
+    size_t ofs;
+    size_t len;
+  }
+runs[] = {{0, 100}, {700, 50}, {5000, 1234}, {12345, 1}, {29000, 1000}};
+
+void
+test_main (void) 
+{
+  const char *file_name = "testfile";
+  size_t i;
+  int fd;
+
+  CHECK (create ("junk", 0), "create \"junk\"");
+  CHECK ((fd = open ("junk")) > 1, "open \"junk\"");
+  memset (junk, 0xcc, sizeof junk);
+  CHECK (write (fd, junk, sizeof junk) == sizeof junk, "write \"junk\"");
+  msg ("close \"junk\"");
+  close (fd);
+  CHECK (remove ("junk"), "remove \"junk\"");
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("write runs to \"%s\"", file_name);
+  for (i = 0; i < sizeof runs / sizeof *runs; i++)
+    {
+      memset (buf + runs[i].ofs, 'x', runs[i].len);
+      seek (fd, runs[i].ofs);
+      if (write (fd, buf + runs[i].ofs, runs[i].len) != (int) runs[i].len)
+        fail ("write %zu bytes at offset %zu failed", runs[i].len, runs[i].ofs);
+    }
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-gap) begin
+(grow-gap) create "junk"
+(grow-gap) open "junk"
+(grow-gap) write "junk"
+(grow-gap) close "junk"
+(grow-gap) remove "junk"
+(grow-gap) create "testfile"
+(grow-gap) open "testfile"
+(grow-gap) write runs to "testfile"
+(grow-gap) close "testfile"
+(grow-gap) open "testfile" for verification
+(grow-gap) verified contents of "testfile"
+(grow-gap) close "testfile"
+(grow-gap) end
+EOF
+pass;
@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (%fs);
+for my $i (0...29) {
+    next if $i % 3 == 0;
+    $fs{"f$i"} = [chr (ord ('a') + $i % 26) x 600];
+}
+check_archive (\%fs);
+pass;
@@ -0,0 +1,44 @@
+/* Creates many small files and removes every third one, so that
+   the free map or FAT changes all over.  The persistence check
+   then needs every change to have reached the disk at shutdown. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 30
+#define FILE_SIZE 600
+
+void
+test_main (void) 
+{
+  char name[16];
+  char buf[FILE_SIZE];
+  int i;
+
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "f%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      memset (buf, 'a' + i % 26, sizeof buf);
+      if (write (fd, buf, sizeof buf) != FILE_SIZE)
+        fail ("write \"%s\" failed", name);
+      close (fd);
+    }
+
+  msg ("remove every third file");
+  for (i = 0; i < FILE_CNT; i += 3) 
+    {
+      snprintf (name, sizeof name, "f%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\" failed", name);
+    }
+}
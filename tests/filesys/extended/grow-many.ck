@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-many) begin
+(grow-many) create 30 files
+(grow-many) remove every third file
+(grow-many) end
+EOF
+pass;
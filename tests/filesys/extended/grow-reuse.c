@@ -0,0 +1,50 @@
+/* Creates, fills and removes a large file over and over.  Together
+   the files take more space than the disk has, so this only passes
+   if the clusters of each removed file can be allocated again.
+
+   This cannot run yet: syscall_handler does not implement the file
+   system calls. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define BLOCK_SIZE 4096
+#define BLOCK_CNT 128
+#define ROUNDS 6
+static char block[BLOCK_SIZE];
+static char check[BLOCK_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "big";
+  int round;
+
+  for (round = 0; round < ROUNDS; round++) 
+    {
+      int fd;
+      int i;
+
+      CHECK (create (file_name, 0), "create \"%s\" (round %d)", file_name, round);
+      CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+      for (i = 0; i < BLOCK_CNT; i++) 
+        {
+          memset (block, 'a' + (round + i) % 26, sizeof block);
+          if (write (fd, block, sizeof block) != BLOCK_SIZE)
+            fail ("write of block %d failed", i);
+        }
+      seek (fd, 0);
+      for (i = 0; i < BLOCK_CNT; i++) 
+        {
+          memset (block, 'a' + (round + i) % 26, sizeof block);
+          if (read (fd, check, sizeof check) != BLOCK_SIZE)
+            fail ("read of block %d failed", i);
+          compare_bytes (check, block, sizeof block, i * BLOCK_SIZE, file_name);
+        }
+      msg ("close \"%s\"", file_name);
+      close (fd);
+      CHECK (remove (file_name), "remove \"%s\"", file_name);
+    }
+}
@@ -0,0 +1,33 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-reuse) begin
+(grow-reuse) create "big" (round 0)
+(grow-reuse) open "big"
+(grow-reuse) close "big"
+(grow-reuse) remove "big"
+(grow-reuse) create "big" (round 1)
+(grow-reuse) open "big"
+(grow-reuse) close "big"
+(grow-reuse) remove "big"
+(grow-reuse) create "big" (round 2)
+(grow-reuse) open "big"
+(grow-reuse) close "big"
+(grow-reuse) remove "big"
+(grow-reuse) create "big" (round 3)
+(grow-reuse) open "big"
+(grow-reuse) close "big"
+(grow-reuse) remove "big"
+(grow-reuse) create "big" (round 4)
+(grow-reuse) open "big"
+(grow-reuse) close "big"
+(grow-reuse) remove "big"
+(grow-reuse) create "big" (round 5)
+(grow-reuse) open "big"
+(grow-reuse) close "big"
+(grow-reuse) remove "big"
+(grow-reuse) end
+EOF
+pass;
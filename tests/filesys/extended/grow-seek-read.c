@@ -0,0 +1,61 @@
+/* Grows two files in alternating pieces, so that their data ends up
+   in several runs, then reads one of them back at random offsets,
+   out of order.  Each read must return the bytes written there. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 20000
+#define PIECE_SIZE 4096
+#define READ_CNT 200
+static char buf_a[FILE_SIZE];
+static char buf_b[FILE_SIZE];
+static char block[PIECE_SIZE];
+
+void
+test_main (void) 
+{
+  size_t ofs;
+  int fd_a, fd_b;
+  int i;
+
+  random_init (0);
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd_a = open ("a")) > 1, "open \"a\"");
+  CHECK ((fd_b = open ("b")) > 1, "open \"b\"");
+
+  msg ("write \"a\" and \"b\" alternately");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += PIECE_SIZE) 
+    {
+      size_t size = FILE_SIZE - ofs < PIECE_SIZE ? FILE_SIZE - ofs : PIECE_SIZE;
+
+      if (write (fd_a, buf_a + ofs, size) != (int) size)
+        fail ("write %zu bytes at offset %zu in \"a\" failed", size, ofs);
+      if (write (fd_b, buf_b + ofs, size) != (int) size)
+        fail ("write %zu bytes at offset %zu in \"b\" failed", size, ofs);
+    }
+
+  msg ("read \"a\" at random offsets");
+  for (i = 0; i < READ_CNT; i++) 
+    {
+      size_t size = random_ulong () % PIECE_SIZE + 1;
+
+      ofs = random_ulong () % (FILE_SIZE - size + 1);
+      seek (fd_a, ofs);
+      if (read (fd_a, block, size) != (int) size)
+        fail ("read %zu bytes at offset %zu in \"a\" failed", size, ofs);
+      compare_bytes (block, buf_a + ofs, size, ofs, "a");
+    }
+
+  msg ("close \"a\"");
+  close (fd_a);
+  msg ("close \"b\"");
+  close (fd_b);
+}
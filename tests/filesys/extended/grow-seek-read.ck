@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-seek-read) begin
+(grow-seek-read) create "a"
+(grow-seek-read) create "b"
+(grow-seek-read) open "a"
+(grow-seek-read) open "b"
+(grow-seek-read) write "a" and "b" alternately
+(grow-seek-read) read "a" at random offsets
+(grow-seek-read) close "a"
+(grow-seek-read) close "b"
+(grow-seek-read) end
+EOF
+pass;
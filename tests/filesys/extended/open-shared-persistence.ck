@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my (%fs);
+$fs{"g$_"} = ["file $_"] foreach 0...7;
+check_archive (\%fs);
+pass;
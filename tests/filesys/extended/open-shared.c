@@ -0,0 +1,78 @@
+/* Opens each of several files many times over, writes through one
+   descriptor and checks that every other descriptor for the same
+   file sees the data at once, since they share an inode.  Then
+   closes everything and opens each file once more.
+
+   This cannot run yet: syscall_handler does not implement the file
+   system calls. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 8
+#define OPEN_CNT 4
+
+void
+test_main (void) 
+{
+  int fds[FILE_CNT][OPEN_CNT];
+  char name[16], data[16], buf[16];
+  int i, j;
+
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "g%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+
+  msg ("open each file %d times", OPEN_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    for (j = 0; j < OPEN_CNT; j++) 
+      {
+        snprintf (name, sizeof name, "g%d", i);
+        if ((fds[i][j] = open (name)) < 2)
+          fail ("open \"%s\" failed", name);
+      }
+
+  msg ("write through one descriptor, read through the others");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      int len = snprintf (data, sizeof data, "file %d", i);
+
+      snprintf (name, sizeof name, "g%d", i);
+      if (write (fds[i][0], data, len) != len)
+        fail ("write to \"%s\" failed", name);
+      for (j = 1; j < OPEN_CNT; j++) 
+        {
+          if (filesize (fds[i][j]) != len)
+            fail ("descriptor %d of \"%s\" has the wrong size", j, name);
+          if (read (fds[i][j], buf, len) != len)
+            fail ("read from \"%s\" failed", name);
+          compare_bytes (buf, data, len, 0, name);
+        }
+    }
+
+  msg ("close all descriptors");
+  for (i = 0; i < FILE_CNT; i++)
+    for (j = 0; j < OPEN_CNT; j++)
+      close (fds[i][j]);
+
+  msg ("reopen each file");
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      int len = snprintf (data, sizeof data, "file %d", i);
+      int fd;
+
+      snprintf (name, sizeof name, "g%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      if (filesize (fd) != len)
+        fail ("\"%s\" has the wrong size", name);
+      close (fd);
+    }
+}
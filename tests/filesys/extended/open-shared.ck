@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(open-shared) begin
+(open-shared) create 8 files
+(open-shared) open each file 4 times
+(open-shared) write through one descriptor, read through the others
+(open-shared) close all descriptors
+(open-shared) reopen each file
+(open-shared) end
+EOF
+pass;
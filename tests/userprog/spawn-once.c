@@ -0,0 +1,23 @@
+/* Spawns a child process from a command line that crosses a page
+   boundary, and waits for it.  Then checks that spawn fails for a
+   missing program, a bad command line pointer, and a bad pointer to
+   the descriptor actions. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/userprog/boundary.h"
+
+void
+test_main (void)
+{
+  struct spawn_fd_action none[] = {{-1, 0}};
+
+  msg ("wait(spawn()) = %d",
+       wait (spawn (copy_string_across_boundary ("child-simple"), none)));
+  msg ("spawn(\"no-such-file\") = %d", spawn ("no-such-file", NULL));
+  msg ("spawn(bad pointer) = %d", spawn ((char *) 0x20101234, NULL));
+  msg ("spawn(bad actions) = %d",
+       spawn ("child-simple", (struct spawn_fd_action *) 0x20101234));
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(spawn-once) begin
+(child-simple) run
+child-simple: exit(81)
+(spawn-once) wait(spawn()) = 81
+load: no-such-file: open failed
+(spawn-once) spawn("no-such-file") = -1
+(spawn-once) spawn(bad pointer) = -1
+(spawn-once) spawn(bad actions) = -1
+(spawn-once) end
+spawn-once: exit(0)
+EOF
+pass;
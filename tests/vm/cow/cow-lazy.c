@@ -0,0 +1,38 @@
+/* Forks before a page of initialized data was ever touched.  Fork
+   must not load the page: it stays unloaded in the child until the
+   child reads it, and in the parent even after that.  Both processes
+   must then read the same contents from the executable. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/cksum.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+
+void
+test_main (void)
+{
+  /* Far from the data that the test library touches, and from the
+     pages that faulting it in would bring in around it. */
+  char *page = (char *) (((uintptr_t) large + 1024 * 1024)
+                         & ~(uintptr_t) (PAGE_SIZE - 1));
+  pid_t child;
+  int status;
+
+  CHECK (get_phys_addr (page) == 0, "page is not loaded before fork");
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      CHECK (get_phys_addr (page) == 0, "child's page is not loaded");
+      exit (cksum (page, PAGE_SIZE) % 128);
+    }
+
+  status = wait (child);
+  CHECK (get_phys_addr (page) == 0, "parent's page is still not loaded");
+  CHECK (status == (int) (cksum (page, PAGE_SIZE) % 128),
+         "child read the same data");
+}
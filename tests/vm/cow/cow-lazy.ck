@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-lazy) begin
+(cow-lazy) page is not loaded before fork
+(cow-lazy) child's page is not loaded
+(cow-lazy) parent's page is still not loaded
+(cow-lazy) child read the same data
+(cow-lazy) end
+EOF
+pass;
@@ -0,0 +1,53 @@
+/* Forks while two written pages are shared copy-on-write, then has
+   the parent and the child each write to the first one.  Each process
+   must see only its own write, and the second page, which neither
+   writes, must stay as it was. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[2 * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+/* Returns true if the SIZE bytes at P are all C. */
+static bool
+all_equal (const char *p, char c, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (p[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+
+  msg ("fill pages");
+  memset (buf, 'a', sizeof buf);
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      CHECK (all_equal (buf, 'a', sizeof buf),
+             "child sees the data from before fork");
+      memset (buf, 'c', PAGE_SIZE);
+      CHECK (all_equal (buf, 'c', PAGE_SIZE), "child sees its own write");
+      CHECK (all_equal (buf + PAGE_SIZE, 'a', PAGE_SIZE),
+             "child's other page is unchanged");
+      return;
+    }
+
+  /* Races with the child's reads, which must not see it. */
+  memset (buf, 'p', PAGE_SIZE);
+  wait (child);
+  CHECK (all_equal (buf, 'p', PAGE_SIZE), "parent sees its own write");
+  CHECK (all_equal (buf + PAGE_SIZE, 'a', PAGE_SIZE),
+         "parent's other page is unchanged");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(cow-write) begin
+(cow-write) fill pages
+(cow-write) child sees the data from before fork
+(cow-write) child sees its own write
+(cow-write) child's other page is unchanged
+(cow-write) end
+(cow-write) parent sees its own write
+(cow-write) parent's other page is unchanged
+(cow-write) end
+EOF
+pass;
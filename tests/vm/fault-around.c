@@ -0,0 +1,42 @@
+/* Touches one page of lazily loaded data and checks that the kernel
+   also brought in the rest of the aligned 8-page window around it, and
+   nothing beyond, with the contents from the executable. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+#define WINDOW 8
+
+void
+test_main (void)
+{
+  uintptr_t span = WINDOW * PAGE_SIZE;
+  char *start = (char *) (((uintptr_t) large + 512 * 1024 + span - 1)
+                          & ~(span - 1));
+  size_t i, j;
+
+  for (i = 0; i <= WINDOW; i++)
+    if (get_phys_addr (start + i * PAGE_SIZE) != 0)
+      fail ("page %zu is loaded before it is touched", i);
+  msg ("window is not loaded");
+
+  CHECK (start[3 * PAGE_SIZE] != 0, "touch one page in the window");
+
+  for (i = 0; i < WINDOW; i++)
+    if (get_phys_addr (start + i * PAGE_SIZE) == 0)
+      fail ("page %zu of the window is not loaded", i);
+  msg ("whole window is loaded");
+  CHECK (get_phys_addr (start + WINDOW * PAGE_SIZE) == 0,
+         "page after the window is not loaded");
+
+  /* The data is text, so it has no zero bytes. */
+  for (i = 0; i < WINDOW; i++)
+    for (j = 0; j < PAGE_SIZE; j++)
+      if (start[i * PAGE_SIZE + j] == 0)
+        fail ("byte %zu of page %zu was not read from the file", j, i);
+  msg ("window holds the file's data");
+}
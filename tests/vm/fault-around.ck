@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fault-around) begin
+(fault-around) window is not loaded
+(fault-around) touch one page in the window
+(fault-around) whole window is loaded
+(fault-around) page after the window is not loaded
+(fault-around) window holds the file's data
+(fault-around) end
+EOF
+pass;
@@ -0,0 +1,58 @@
+/* Takes read faults on untouched bss pages and on lazily loaded data
+   pages, and checks that SYS_FAULTSTAT counted them by cause, with
+   every fault in the latency histogram. */
+
+#include <stdint.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+
+static char zeros[4 * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+static struct fault_stats before, after, all;
+
+/* Returns true if the histogram of CAUSE in S adds up to its count. */
+static bool
+hist_matches (const struct fault_stats *s, int cause)
+{
+  long long sum = 0;
+  int i;
+
+  for (i = 0; i < FAULT_HIST_BUCKETS; i++)
+    sum += s->hist[cause][i];
+  return sum == s->cnt[cause];
+}
+
+void
+test_main (void)
+{
+  char *data = (char *) (((uintptr_t) large + 1024 * 1024)
+                         & ~(uintptr_t) (PAGE_SIZE - 1));
+  volatile char c;
+  int i;
+
+  CHECK (faultstat (&before, false), "read process statistics");
+
+  for (i = 0; i < 4; i++)
+    c = zeros[i * PAGE_SIZE];
+  c = data[0];
+  (void) c;
+
+  CHECK (faultstat (&after, false), "read them again");
+  CHECK (after.cnt[FAULT_ZERO] >= before.cnt[FAULT_ZERO] + 4,
+         "bss reads count as zero-fill faults");
+  CHECK (after.cnt[FAULT_LAZY] >= before.cnt[FAULT_LAZY] + 1,
+         "data read counts as a lazy-load fault");
+  for (i = 0; i < FAULT_CAUSE_CNT; i++)
+    if (!hist_matches (&after, i))
+      fail ("histogram of cause %d does not add up", i);
+  msg ("histograms add up to the counts");
+
+  CHECK (faultstat (&all, true), "read system-wide statistics");
+  CHECK (all.cnt[FAULT_ZERO] >= after.cnt[FAULT_ZERO]
+         && all.cnt[FAULT_LAZY] >= after.cnt[FAULT_LAZY],
+         "system-wide counts include this process");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(faultstat) begin
+(faultstat) read process statistics
+(faultstat) read them again
+(faultstat) bss reads count as zero-fill faults
+(faultstat) data read counts as a lazy-load fault
+(faultstat) histograms add up to the counts
+(faultstat) read system-wide statistics
+(faultstat) system-wide counts include this process
+(faultstat) end
+EOF
+pass;
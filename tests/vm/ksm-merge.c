@@ -0,0 +1,42 @@
+/* Fills two pages with the same data and waits for the same-page
+   merging thread to put them in one frame.  A write to one of them
+   must then give it a frame of its own again, leaving the other one
+   as it was.
+
+   This cannot run yet: syscall_handler does not implement write() or
+   exit(), and nothing handles the get_phys_addr() interrupt. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char pages[2 * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+static bool
+merged (void)
+{
+  return get_phys_addr (pages) == get_phys_addr (pages + PAGE_SIZE);
+}
+
+void
+test_main (void)
+{
+  char *a = pages, *b = pages + PAGE_SIZE;
+  size_t i, tries;
+
+  for (i = 0; i < PAGE_SIZE; i++)
+    a[i] = b[i] = "ksm"[i % 3];
+  msg ("fill two pages alike");
+
+  for (tries = 0; tries < 10000000 && !merged (); tries++)
+    continue;
+  CHECK (merged (), "pages are merged into one frame");
+
+  a[0] = '!';
+  CHECK (!merged (), "write gives the page its own frame");
+  CHECK (a[0] == '!' && a[1] == 's', "written page has the write");
+  CHECK (b[0] == 'k' && b[1] == 's', "other page is unchanged");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(ksm-merge) begin
+(ksm-merge) fill two pages alike
+(ksm-merge) pages are merged into one frame
+(ksm-merge) write gives the page its own frame
+(ksm-merge) written page has the write
+(ksm-merge) other page is unchanged
+(ksm-merge) end
+EOF
+pass;
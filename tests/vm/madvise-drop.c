@@ -0,0 +1,60 @@
+/* Drops written anonymous pages, of data and of the stack, with
+   MADV_DONTNEED and checks that they read back as zeros while their
+   neighbours keep their data.  Also checks that madvise rejects a
+   misaligned address, unknown advice, and unmapped memory. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char buf[4 * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+/* Drops a page in the middle of a large stack object. */
+static void
+drop_stack_page (void)
+{
+  char big[3 * PAGE_SIZE];
+  char *page = (char *) (((uintptr_t) big + PAGE_SIZE - 1)
+                         & ~(uintptr_t) (PAGE_SIZE - 1));
+
+  memset (big, 's', sizeof big);
+  CHECK (madvise (page, PAGE_SIZE, MADV_DONTNEED) == 0,
+         "drop a stack page");
+  CHECK (page[0] == 0 && page[PAGE_SIZE - 1] == 0,
+         "dropped stack page reads as zeros");
+  CHECK (page[-1] == 's' && page[PAGE_SIZE] == 's',
+         "rest of the stack object keeps its data");
+  page[0] = 't';
+  CHECK (page[0] == 't', "dropped stack page can be written again");
+}
+
+void
+test_main (void)
+{
+  size_t i;
+
+  memset (buf, 'x', sizeof buf);
+  CHECK (madvise (buf, 2 * PAGE_SIZE, MADV_DONTNEED) == 0,
+         "drop two data pages");
+  for (i = 0; i < 2 * PAGE_SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu of the dropped pages is %02hhx", i, buf[i]);
+  msg ("dropped data pages read as zeros");
+  for (i = 2 * PAGE_SIZE; i < sizeof buf; i++)
+    if (buf[i] != 'x')
+      fail ("byte %zu of the kept pages is %02hhx", i, buf[i]);
+  msg ("other data pages keep their data");
+
+  drop_stack_page ();
+
+  CHECK (madvise (buf + 1, PAGE_SIZE, MADV_DONTNEED) == -1,
+         "misaligned address is rejected");
+  CHECK (madvise (buf, PAGE_SIZE, 99) == -1, "unknown advice is rejected");
+  CHECK (madvise ((void *) 0x70000000, PAGE_SIZE, MADV_NORMAL) == -1,
+         "unmapped range is rejected");
+}
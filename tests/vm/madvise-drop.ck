@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(madvise-drop) begin
+(madvise-drop) drop two data pages
+(madvise-drop) dropped data pages read as zeros
+(madvise-drop) other data pages keep their data
+(madvise-drop) drop a stack page
+(madvise-drop) dropped stack page reads as zeros
+(madvise-drop) rest of the stack object keeps its data
+(madvise-drop) dropped stack page can be written again
+(madvise-drop) misaligned address is rejected
+(madvise-drop) unknown advice is rejected
+(madvise-drop) unmapped range is rejected
+(madvise-drop) end
+EOF
+pass;
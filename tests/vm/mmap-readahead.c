@@ -0,0 +1,54 @@
+/* Scans a mapping of "large.txt" from the start and checks that
+   sequential faults read ahead of the scan, but a region advised
+   MADV_RANDOM does not. */
+
+#include <string.h>
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/vm/large.inc"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT 32
+
+static bool
+loaded (char *map, size_t page)
+{
+  return get_phys_addr (map + page * PAGE_SIZE) != 0;
+}
+
+void
+test_main (void)
+{
+  char *seq = (char *) 0x10000000;
+  char *rnd = (char *) 0x20000000;
+  size_t size = PAGE_CNT * PAGE_SIZE;
+  int handle;
+
+  CHECK ((handle = open ("large.txt")) > 1, "open \"large.txt\"");
+  CHECK (mmap (seq, size, 0, handle, 0) == seq, "mmap \"large.txt\"");
+  CHECK (mmap (rnd, size, 0, handle, 0) == rnd, "mmap \"large.txt\" again");
+  CHECK (madvise (rnd, size, MADV_RANDOM) == 0, "advise MADV_RANDOM");
+
+  CHECK (seq[0] == large[0], "touch page 0");
+  CHECK (!loaded (seq, 1), "page 1 is not read ahead yet");
+  CHECK (seq[PAGE_SIZE] == large[PAGE_SIZE], "touch page 1");
+  CHECK (loaded (seq, 2), "page 2 is read ahead");
+  CHECK (!loaded (seq, 8), "page 8 is not read yet");
+
+  if (memcmp (seq, large, size))
+    fail ("sequential scan read bad data");
+  msg ("sequential scan reads the file");
+
+  CHECK (rnd[0] == large[0], "touch random page 0");
+  CHECK (rnd[PAGE_SIZE] == large[PAGE_SIZE], "touch random page 1");
+  CHECK (!loaded (rnd, 2), "random page 2 is not read ahead");
+  if (memcmp (rnd, large, size))
+    fail ("random scan read bad data");
+  msg ("random scan reads the file");
+
+  munmap (rnd);
+  munmap (seq);
+  close (handle);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-readahead) begin
+(mmap-readahead) open "large.txt"
+(mmap-readahead) mmap "large.txt"
+(mmap-readahead) mmap "large.txt" again
+(mmap-readahead) advise MADV_RANDOM
+(mmap-readahead) touch page 0
+(mmap-readahead) page 1 is not read ahead yet
+(mmap-readahead) touch page 1
+(mmap-readahead) page 2 is read ahead
+(mmap-readahead) page 8 is not read yet
+(mmap-readahead) sequential scan reads the file
+(mmap-readahead) touch random page 0
+(mmap-readahead) touch random page 1
+(mmap-readahead) random page 2 is not read ahead
+(mmap-readahead) random scan reads the file
+(mmap-readahead) end
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Maps one file twice, through two separate opens, and checks that
+   both mappings use the same frame and see each other's writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define MAP1 ((char *) 0x10000000)
+#define MAP2 ((char *) 0x20000000)
+
+void
+test_main (void)
+{
+  int handle1, handle2;
+
+  CHECK (create ("sample.txt", strlen (sample)), "create \"sample.txt\"");
+  CHECK ((handle1 = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((handle2 = open ("sample.txt")) > 1, "open \"sample.txt\" again");
+  CHECK (mmap (MAP1, 4096, 1, handle1, 0) == MAP1, "mmap \"sample.txt\"");
+  CHECK (mmap (MAP2, 4096, 1, handle2, 0) == MAP2,
+         "mmap \"sample.txt\" again");
+
+  memcpy (MAP1, sample, strlen (sample));
+  CHECK (!memcmp (MAP2, sample, strlen (sample)),
+         "second mapping sees the write");
+  CHECK (get_phys_addr (MAP1) == get_phys_addr (MAP2),
+         "both mappings share one frame");
+
+  MAP2[0] = '#';
+  CHECK (MAP1[0] == '#', "first mapping sees the write back");
+
+  munmap (MAP1);
+  munmap (MAP2);
+  close (handle1);
+  close (handle2);
+}
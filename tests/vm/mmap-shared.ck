@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-shared) begin
+(mmap-shared) create "sample.txt"
+(mmap-shared) open "sample.txt"
+(mmap-shared) open "sample.txt" again
+(mmap-shared) mmap "sample.txt"
+(mmap-shared) mmap "sample.txt" again
+(mmap-shared) second mapping sees the write
+(mmap-shared) both mappings share one frame
+(mmap-shared) first mapping sees the write back
+(mmap-shared) end
+EOF
+pass;
@@ -0,0 +1,51 @@
+/* Writes to every other page of an 8-page mapping, in no particular
+   order, and to the partial last page, then unmaps it and reads the
+   file back with read(): the written pages must have reached the file
+   and the untouched ones must be as they were.
+
+   This cannot run yet: syscall_handler does not implement the file
+   system calls, mmap() or munmap(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define FILE_SIZE (7 * PAGE_SIZE + 100)
+#define ACTUAL ((char *) 0x10000000)
+
+static char expected[FILE_SIZE];
+static char buf[FILE_SIZE];
+
+void
+test_main (void)
+{
+  static const int order[] = {6, 2, 0, 4};
+  int handle;
+  size_t i;
+
+  CHECK (create ("wb.dat", FILE_SIZE), "create \"wb.dat\"");
+  CHECK ((handle = open ("wb.dat")) > 1, "open \"wb.dat\"");
+  CHECK (mmap (ACTUAL, FILE_SIZE, 1, handle, 0) == ACTUAL, "mmap \"wb.dat\"");
+
+  for (i = 0; i < sizeof order / sizeof *order; i++)
+    {
+      char *page = ACTUAL + order[i] * PAGE_SIZE;
+
+      memset (page, 'a' + order[i], PAGE_SIZE);
+      memset (expected + order[i] * PAGE_SIZE, 'a' + order[i], PAGE_SIZE);
+    }
+  memset (ACTUAL + 7 * PAGE_SIZE, 'z', 100);
+  memset (expected + 7 * PAGE_SIZE, 'z', 100);
+  for (i = 1; i < 7; i += 2)
+    if (ACTUAL[i * PAGE_SIZE] != 0)
+      fail ("untouched page %zu is not zero", i);
+  msg ("write pages 6, 2, 0, 4 and the tail");
+
+  munmap (ACTUAL);
+  CHECK (read (handle, buf, FILE_SIZE) == FILE_SIZE, "read \"wb.dat\"");
+  CHECK (!memcmp (buf, expected, FILE_SIZE),
+         "file holds the written pages and nothing else");
+  close (handle);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-writeback) begin
+(mmap-writeback) create "wb.dat"
+(mmap-writeback) open "wb.dat"
+(mmap-writeback) mmap "wb.dat"
+(mmap-writeback) write pages 6, 2, 0, 4 and the tail
+(mmap-writeback) read "wb.dat"
+(mmap-writeback) file holds the written pages and nothing else
+(mmap-writeback) end
+EOF
+pass;
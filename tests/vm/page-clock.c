@@ -0,0 +1,43 @@
+/* Keeps a few pages hot while streaming through a region much
+   larger than memory, so that the clock has to evict around them,
+   and then checks that every page kept its contents. */
+
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define HOT_PAGES 16
+#define COLD_PAGES (8 * 256)            /* 8 MB. */
+
+static char hot[HOT_PAGES * PAGE_SIZE];
+static char cold[COLD_PAGES * PAGE_SIZE];
+
+void
+test_main (void)
+{
+  size_t i, j;
+
+  msg ("write hot pages");
+  for (i = 0; i < HOT_PAGES; i++)
+    memset (hot + i * PAGE_SIZE, i + 1, PAGE_SIZE);
+
+  msg ("stream through cold pages");
+  for (i = 0; i < COLD_PAGES; i++)
+    {
+      cold[i * PAGE_SIZE] = (char) i;
+      for (j = 0; j < HOT_PAGES; j++)
+        if (hot[j * PAGE_SIZE] != (char) (j + 1))
+          fail ("hot page %zu changed", j);
+    }
+
+  msg ("check hot pages");
+  for (i = 0; i < HOT_PAGES * PAGE_SIZE; i++)
+    if (hot[i] != (char) (i / PAGE_SIZE + 1))
+      fail ("byte %zu of hot pages is wrong", i);
+
+  msg ("check cold pages");
+  for (i = 0; i < COLD_PAGES; i++)
+    if (cold[i * PAGE_SIZE] != (char) i)
+      fail ("cold page %zu is wrong", i);
+}
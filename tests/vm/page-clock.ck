@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(page-clock) begin
+(page-clock) write hot pages
+(page-clock) stream through cold pages
+(page-clock) check hot pages
+(page-clock) check cold pages
+(page-clock) end
+EOF
+pass;
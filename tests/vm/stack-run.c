@@ -0,0 +1,43 @@
+/* Touches the lowest byte of a 64 kB stack object first, and checks
+   that the stack grew in one run that covers the whole object, not
+   just the page that faulted.  Then uses all of the object.
+
+   This cannot run yet: syscall_handler does not implement write() or
+   exit(), and nothing handles the get_phys_addr() interrupt. */
+
+#include <string.h>
+#include <stdint.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define OBJ_SIZE (64 * 1024)
+
+static void
+use_object (void)
+{
+  volatile char obj[OBJ_SIZE];
+  uintptr_t page;
+  size_t i;
+
+  obj[0] = 'x';
+  for (page = ((uintptr_t) obj + PAGE_SIZE - 1) & ~(uintptr_t) (PAGE_SIZE - 1);
+       page < (uintptr_t) obj + OBJ_SIZE; page += PAGE_SIZE)
+    if (get_phys_addr ((void *) page) == 0)
+      fail ("stack page at %p was not brought in", (void *) page);
+  msg ("whole object is mapped after one fault");
+
+  for (i = 0; i < OBJ_SIZE; i++)
+    obj[i] = i % 251;
+  for (i = 0; i < OBJ_SIZE; i++)
+    if (obj[i] != (char) (i % 251))
+      fail ("byte %zu of the object is wrong", i);
+  msg ("object holds its data");
+}
+
+void
+test_main (void)
+{
+  use_object ();
+}
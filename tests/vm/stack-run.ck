@@ -0,0 +1,11 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(stack-run) begin
+(stack-run) whole object is mapped after one fault
+(stack-run) object holds its data
+(stack-run) end
+EOF
+pass;
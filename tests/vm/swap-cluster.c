@@ -0,0 +1,46 @@
+/* Fills more anonymous memory than fits in RAM with random bytes,
+   which do not compress, so that whole pages go out to the swap disk
+   in clustered slots, and reads them back first in reverse and then
+   in forward order, checking every byte of every page. */
+
+#include <string.h>
+#include "tests/arc4.h"
+#include "tests/cksum.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT (6 * 256)              /* 6 MB. */
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+static unsigned long sums[PAGE_CNT];
+
+static void
+check_page (size_t i)
+{
+  if (cksum (buf + i * PAGE_SIZE, PAGE_SIZE) != sums[i])
+    fail ("page %zu has the wrong contents", i);
+}
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+  size_t i;
+
+  msg ("fill pages with random bytes");
+  arc4_init (&arc4, "swap-cluster", 12);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      arc4_crypt (&arc4, buf + i * PAGE_SIZE, PAGE_SIZE);
+      sums[i] = cksum (buf + i * PAGE_SIZE, PAGE_SIZE);
+    }
+
+  msg ("check pages in reverse order");
+  for (i = PAGE_CNT; i-- > 0; )
+    check_page (i);
+
+  msg ("check pages in forward order");
+  for (i = 0; i < PAGE_CNT; i++)
+    check_page (i);
+}
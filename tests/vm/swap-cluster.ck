@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-cluster) begin
+(swap-cluster) fill pages with random bytes
+(swap-cluster) check pages in reverse order
+(swap-cluster) check pages in forward order
+(swap-cluster) end
+EOF
+pass;
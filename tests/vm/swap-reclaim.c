@@ -0,0 +1,51 @@
+/* Forks, and has the parent and the child each fill and then check
+   6 MB of their own anonymous memory at the same time, with 8 MB of
+   physical memory.  Reclaim runs in the background and on faults of
+   both processes at once, and every page must come back as it was
+   written. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define CHUNK_SIZE (6 * 1024 * 1024)
+#define PAGE_COUNT (CHUNK_SIZE / PAGE_SIZE)
+
+static char chunk[CHUNK_SIZE];
+
+/* Writes a pattern that depends on SEED to every word of the chunk,
+   then checks it.  Returns true if all of it came back. */
+static bool
+fill_and_check (unsigned seed)
+{
+  size_t i, j;
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    for (j = 0; j < PAGE_SIZE; j += sizeof (unsigned))
+      *(unsigned *) (chunk + i * PAGE_SIZE + j) = seed ^ (i * 7919 + j);
+
+  for (i = 0; i < PAGE_COUNT; i++)
+    for (j = 0; j < PAGE_SIZE; j += sizeof (unsigned))
+      if (*(unsigned *) (chunk + i * PAGE_SIZE + j) != (seed ^ (i * 7919 + j)))
+        return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  pid_t child;
+  bool ok;
+
+  child = fork ("child");
+  if (child == 0)
+    {
+      CHECK (fill_and_check (0x5a5a5a5a), "child's pages come back intact");
+      return;
+    }
+
+  ok = fill_and_check (0xa5a5a5a5);
+  wait (child);
+  CHECK (ok, "parent's pages come back intact");
+}
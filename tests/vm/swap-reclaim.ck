@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-reclaim) begin
+(swap-reclaim) child's pages come back intact
+(swap-reclaim) end
+(swap-reclaim) parent's pages come back intact
+(swap-reclaim) end
+EOF
+pass;
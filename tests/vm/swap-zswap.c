@@ -0,0 +1,66 @@
+/* Runs with a small compressed swap pool.  Half of the pages hold
+   text-like data that compresses well and half hold random bytes that
+   the pool refuses, and together they are larger than memory.  Every
+   page has to come back intact, whether it was kept compressed,
+   written back from the pool to disk, or swapped to disk directly. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/arc4.h"
+#include "tests/cksum.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+#define PAGE_CNT (6 * 256)              /* 6 MB. */
+
+static char buf[PAGE_CNT * PAGE_SIZE];
+static unsigned long sums[PAGE_CNT];
+
+/* Fills page I of BUF with repetitive text. */
+static void
+fill_text (size_t i)
+{
+  char *page = buf + i * PAGE_SIZE;
+  size_t ofs;
+
+  for (ofs = 0; ofs < PAGE_SIZE; )
+    {
+      char line[64];
+      size_t len = snprintf (line, sizeof line, "page %zu, offset %zu\n",
+                             i, ofs);
+
+      if (len > PAGE_SIZE - ofs)
+        len = PAGE_SIZE - ofs;
+      memcpy (page + ofs, line, len);
+      ofs += len;
+    }
+}
+
+void
+test_main (void)
+{
+  struct arc4 arc4;
+  size_t i;
+
+  msg ("fill compressible and random pages");
+  arc4_init (&arc4, "swap-zswap", 10);
+  for (i = 0; i < PAGE_CNT; i++)
+    {
+      if (i % 2 == 0)
+        fill_text (i);
+      else
+        arc4_crypt (&arc4, buf + i * PAGE_SIZE, PAGE_SIZE);
+      sums[i] = cksum (buf + i * PAGE_SIZE, PAGE_SIZE);
+    }
+
+  msg ("check pages");
+  for (i = 0; i < PAGE_CNT; i++)
+    if (cksum (buf + i * PAGE_SIZE, PAGE_SIZE) != sums[i])
+      fail ("page %zu has the wrong contents", i);
+
+  msg ("check pages again");
+  for (i = PAGE_CNT; i-- > 0; )
+    if (cksum (buf + i * PAGE_SIZE, PAGE_SIZE) != sums[i])
+      fail ("page %zu has the wrong contents", i);
+}
@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(swap-zswap) begin
+(swap-zswap) fill compressible and random pages
+(swap-zswap) check pages
+(swap-zswap) check pages again
+(swap-zswap) end
+EOF
+pass;
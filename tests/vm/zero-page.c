@@ -0,0 +1,33 @@
+/* Reads untouched pages of zero-initialized data, which should all be
+   backed by one shared zero page, then writes to one of them, which
+   must give it a page of its own without disturbing the others. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define PAGE_SIZE 4096
+
+static char zeros[4 * PAGE_SIZE] __attribute__ ((aligned (PAGE_SIZE)));
+
+void
+test_main (void)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof zeros; i++)
+    if (zeros[i] != 0)
+      fail ("byte %zu is %02hhx, not zero", i, zeros[i]);
+  msg ("untouched data reads as zeros");
+
+  CHECK (get_phys_addr (&zeros[0]) == get_phys_addr (&zeros[PAGE_SIZE])
+         && get_phys_addr (&zeros[0]) == get_phys_addr (&zeros[3 * PAGE_SIZE]),
+         "read pages share one frame");
+
+  zeros[PAGE_SIZE] = 'x';
+  CHECK (zeros[PAGE_SIZE] == 'x', "written page holds the write");
+  CHECK (get_phys_addr (&zeros[PAGE_SIZE]) != get_phys_addr (&zeros[0]),
+         "written page has its own frame");
+  CHECK (zeros[0] == 0 && zeros[2 * PAGE_SIZE] == 0,
+         "other pages still read as zeros");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(zero-page) begin
+(zero-page) untouched data reads as zeros
+(zero-page) read pages share one frame
+(zero-page) written page holds the write
+(zero-page) written page has its own frame
+(zero-page) other pages still read as zeros
+(zero-page) end
+EOF
+pass;
@@ -34,8 +34,10 @@
 #endif
 #ifdef FILESYS
 #include "devices/disk.h"
+#include "filesys/dentry.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/page_cache.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -216,6 +218,16 @@ parse_options (char **argv) {
 #ifdef FILESYS
 		else if (!strcmp (name, "-f"))
 			format_filesys = true;
+#endif
+#ifdef EFILESYS
+		else if (!strcmp (name, "-cluster")) {
+			fat_format_cluster_sectors = value != NULL ? atoi (value) : 0;
+			if (fat_format_cluster_sectors == 0
+					|| fat_format_cluster_sectors > MAX_SECTORS_PER_CLUSTER
+					|| (fat_format_cluster_sectors
+						& (fat_format_cluster_sectors - 1)) != 0)
+				PANIC ("-cluster must be 1, 2, 4, 8 or 16");
+		}
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
@@ -226,6 +238,29 @@ parse_options (char **argv) {
 			user_page_limit = atoi (value);
 		else if (!strcmp (name, "-threads-tests"))
 			thread_tests = true;
+#endif
+#ifdef VM
+		else if (!strcmp (name, "-fault-around")) {
+			int pages = value != NULL ? atoi (value) : 0;
+
+			if (pages < 1 || pages > FAULT_AROUND_MAX)
+				PANIC ("-fault-around must be between 1 and %d", FAULT_AROUND_MAX);
+			vm_fault_around_pages = pages;
+		}
+		else if (!strcmp (name, "-stack-limit")) {
+			int kb = value != NULL ? atoi (value) : 0;
+
+			if (kb < PGSIZE / 1024)
+				PANIC ("-stack-limit must be at least %d (kB)", PGSIZE / 1024);
+			vm_stack_limit = (size_t) kb * 1024;
+		}
+		else if (!strcmp (name, "-ksm")) {
+			ksm_pages_to_scan = value != NULL ? atoi (value) : 100;
+			if (value != NULL && strchr (value, ',') != NULL)
+				ksm_sleep_ms = atoi (strchr (value, ',') + 1);
+		}
+		else if (!strcmp (name, "-zswap"))
+			zswap_pool_limit = (value != NULL ? atoi (value) : 1024) * 1024;
 #endif
 		else
 			PANIC ("unknown option `%s' (use -h for help)", name);
@@ -272,6 +307,8 @@ run_actions (char **argv) {
 		{"rm", 2, fsutil_rm},
 		{"put", 2, fsutil_put},
 		{"get", 2, fsutil_get},
+		{"frag", 1, fsutil_frag},
+		{"openbench", 1, fsutil_openbench},
 #endif
 		{NULL, 0, NULL},
 	};
@@ -316,6 +353,8 @@ usage (void) {
 			"  ls                 List files in the root directory.\n"
 			"  cat FILE           Print FILE to the console.\n"
 			"  rm FILE            Delete FILE.\n"
+			"  frag               Show how fragmented the files are.\n"
+			"  openbench          Time concurrent opens and closes.\n"
 			"Use these actions indirectly via `pintos' -g and -p options:\n"
 			"  put FILE           Put FILE into file system from scratch disk.\n"
 			"  get FILE           Get FILE from file system into scratch disk.\n"
@@ -324,10 +363,19 @@ usage (void) {
 			"  -h                 Print this help message and power off.\n"
 			"  -q                 Power off VM after actions or on panic.\n"
 			"  -f                 Format file system disk during startup.\n"
+#ifdef EFILESYS
+			"  -cluster=SECTORS   Format with SECTORS (1-16) sectors per cluster.\n"
+#endif
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
+#endif
+#ifdef VM
+			"  -fault-around=N    Map up to N pages around file-backed faults.\n"
+			"  -stack-limit=KB    Let the user stack grow up to KB kB.\n"
+			"  -ksm[=PAGES[,MS]]  Merge identical pages, scanning PAGES every MS ms.\n"
+			"  -zswap[=KB]        Keep up to KB kB of compressed swap in RAM.\n"
 #endif
 			);
 	power_off ();
@@ -356,10 +404,15 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	page_cache_print_stats ();
+	dentry_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
 #ifdef USERPROG
 	exception_print_stats ();
 #endif
+#ifdef VM
+	vm_print_stats ();
+#endif
 }
@@ -1,14 +1,36 @@
 #include "userprog/exception.h"
 #include <inttypes.h>
 #include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 #include "intrinsic.h"
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
 
+/* Page fault accounting.  Every fault is timed with the TSC and
+   counted by cause, both system-wide and for the faulting process.
+   The counts of the last FAULT_PROC_MAX processes to exit are kept
+   for the breakdown printed at shutdown. */
+static struct fault_stats fault_stats;
+
+#define FAULT_PROC_MAX 8
+struct fault_proc {
+	char name[16];
+	long long cnt[FAULT_CAUSE_CNT];
+	long long cycles[FAULT_CAUSE_CNT];
+};
+static struct fault_proc fault_procs[FAULT_PROC_MAX];
+static long long fault_proc_cnt;    /* Processes recorded so far. */
+
+static const char *fault_cause_names[FAULT_CAUSE_CNT] = {
+	"lazy", "zero", "stack", "swap", "cow", "invalid",
+};
+
 static void kill (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
@@ -63,7 +85,101 @@ exception_init (void) {
 /* Prints exception statistics. */
 void
 exception_print_stats (void) {
+	long long first;
+	int c, b;
+
 	printf ("Exception: %lld page faults\n", page_fault_cnt);
+	for (c = 0; c < FAULT_CAUSE_CNT; c++) {
+		long long cnt = fault_stats.cnt[c];
+
+		if (cnt == 0)
+			continue;
+		printf ("Fault %s: %lld, avg %lld cycles, log2 hist", fault_cause_names[c],
+				cnt, fault_stats.cycles[c] / cnt);
+		for (b = 0; b < FAULT_HIST_BUCKETS; b++)
+			if (fault_stats.hist[c][b] != 0)
+				printf (" %d:%lld", b, fault_stats.hist[c][b]);
+		printf ("\n");
+	}
+
+	first = fault_proc_cnt > FAULT_PROC_MAX ? fault_proc_cnt - FAULT_PROC_MAX : 0;
+	for (; first < fault_proc_cnt; first++) {
+		struct fault_proc *p = &fault_procs[first % FAULT_PROC_MAX];
+
+		printf ("Fault %s:", p->name);
+		for (c = 0; c < FAULT_CAUSE_CNT; c++)
+			if (p->cnt[c] != 0)
+				printf (" %s %lld (avg %lld)", fault_cause_names[c], p->cnt[c],
+						p->cycles[c] / p->cnt[c]);
+		printf ("\n");
+	}
+}
+
+/* Copies the fault statistics into ST: the system-wide ones if ALL
+   is true, those of the current process otherwise. */
+void
+exception_get_fault_stats (struct fault_stats *st, bool all) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level = intr_disable ();
+
+	if (all)
+		*st = fault_stats;
+	else if (t->fault_stats != NULL)
+		*st = *t->fault_stats;
+	else
+		memset (st, 0, sizeof *st);
+	intr_set_level (old_level);
+}
+
+/* Moves the fault counts of exiting process T into the shutdown
+   breakdown and frees its statistics. */
+void
+exception_release_fault_stats (struct thread *t) {
+	struct fault_stats *st = t->fault_stats;
+	struct fault_proc *p;
+	enum intr_level old_level;
+
+	if (st == NULL)
+		return;
+	t->fault_stats = NULL;
+
+	old_level = intr_disable ();
+	p = &fault_procs[fault_proc_cnt++ % FAULT_PROC_MAX];
+	strlcpy (p->name, t->name, sizeof p->name);
+	memcpy (p->cnt, st->cnt, sizeof p->cnt);
+	memcpy (p->cycles, st->cycles, sizeof p->cycles);
+	intr_set_level (old_level);
+	free (st);
+}
+
+/* Adds a fault of CAUSE that took CYCLES to ST. */
+static void
+fault_account (struct fault_stats *st, enum fault_cause cause,
+		uint64_t cycles) {
+	int bucket = 0;
+
+	while (cycles >> (bucket + 1) != 0 && bucket < FAULT_HIST_BUCKETS - 1)
+		bucket++;
+	st->cnt[cause]++;
+	st->cycles[cause] += cycles;
+	st->hist[cause][bucket]++;
+}
+
+/* Records a page fault of CAUSE that took CYCLES to handle. */
+static void
+record_fault (enum fault_cause cause, uint64_t cycles) {
+	struct thread *t = thread_current ();
+	enum intr_level old_level;
+
+	/* Invalid faults may come from kernel bugs; don't allocate then. */
+	if (t->pml4 != NULL && t->fault_stats == NULL && cause != FAULT_INVALID)
+		t->fault_stats = calloc (1, sizeof *t->fault_stats);
+
+	old_level = intr_disable ();
+	fault_account (&fault_stats, cause, cycles);
+	if (t->fault_stats != NULL)
+		fault_account (t->fault_stats, cause, cycles);
+	intr_set_level (old_level);
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -122,6 +238,7 @@ page_fault (struct intr_frame *f) {
 	bool write;        /* True: access was write, false: access was read. */
 	bool user;         /* True: access by user, false: access by kernel. */
 	void *fault_addr;  /* Fault address. */
+	uint64_t start;    /* TSC when the fault was taken. */
 
 	/* Obtain faulting address, the virtual address that was
 	   accessed to cause the fault.  It may point to code or to
@@ -129,6 +246,7 @@ page_fault (struct intr_frame *f) {
 	   that caused the fault (that's f->rip). */
 
 	fault_addr = (void *) rcr2();
+	start = rdtsc ();
 
 	/* Turn interrupts back on (they were only off so that we could
 	   be assured of reading CR2 before it changed). */
@@ -142,9 +260,13 @@ page_fault (struct intr_frame *f) {
 
 #ifdef VM
 	/* For project 3 and later. */
-	if (vm_try_handle_fault (f, fault_addr, user, write, not_present))
+	thread_current ()->fault_cause = FAULT_INVALID;
+	if (vm_try_handle_fault (f, fault_addr, user, write, not_present)) {
+		record_fault (thread_current ()->fault_cause, rdtsc () - start);
 		return;
+	}
 #endif
+	record_fault (FAULT_INVALID, rdtsc () - start);
 
 	/* Count page faults. */
 	page_fault_cnt++;
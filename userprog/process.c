@@ -5,6 +5,8 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <syscall-nr.h>
+#include "userprog/exception.h"
 #include "userprog/gdt.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
@@ -13,7 +15,9 @@
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/mmu.h"
 #include "threads/vaddr.h"
@@ -25,6 +29,7 @@
 static void process_cleanup (void);
 static bool load (const char *file_name, struct intr_frame *if_);
 static void initd (void *f_name);
+static void spawnd (void *aux);
 static void __do_fork (void *);
 
 /* General process initializer for initd and other process. */
@@ -71,6 +76,81 @@ initd (void *f_name) {
 	NOT_REACHED ();
 }
 
+/* Passed from process_spawn() to the child. */
+struct spawn_args {
+	char *cmd_line;                             /* Command line, in a page. */
+	struct semaphore loaded;                    /* Upped once loaded. */
+	bool success;                               /* Did the load succeed? */
+};
+
+/* Starts a new process running CMD_LINE directly, without first
+ * duplicating the current address space the way fork() followed by
+ * exec() would.  FD_ACTIONS, which may be NULL, lists descriptors for
+ * the child to inherit; the kernel has no file descriptors yet, so any
+ * action in it is refused rather than dropped.  Returns the child's
+ * thread id once its program has loaded, or TID_ERROR on failure. */
+tid_t
+process_spawn (const char *cmd_line,
+		const struct spawn_fd_action *fd_actions) {
+	struct spawn_args args;
+	char name[16];
+	size_t len;
+	tid_t tid;
+
+	if (fd_actions != NULL && fd_actions[0].fd != -1)
+		return TID_ERROR;
+
+	args.cmd_line = palloc_get_page (0);
+	if (args.cmd_line == NULL)
+		return TID_ERROR;
+	strlcpy (args.cmd_line, cmd_line, PGSIZE);
+	sema_init (&args.loaded, 0);
+	args.success = false;
+
+	/* The thread is named after the program. */
+	len = strcspn (args.cmd_line, " ");
+	strlcpy (name, args.cmd_line, len + 1 < sizeof name ? len + 1 : sizeof name);
+
+	tid = thread_create (name, PRI_DEFAULT, spawnd, &args);
+	if (tid == TID_ERROR) {
+		palloc_free_page (args.cmd_line);
+		return TID_ERROR;
+	}
+	sema_down (&args.loaded);
+	return args.success ? tid : TID_ERROR;
+}
+
+/* A thread function that loads and starts a spawned process. */
+static void
+spawnd (void *aux) {
+	struct spawn_args *args = aux;
+	struct intr_frame _if;
+
+#ifdef VM
+	supplemental_page_table_init (&thread_current ()->spt);
+#endif
+	process_init ();
+
+	/* Only the descriptors in ARGS->fds would be installed here, but
+	 * processes do not have a descriptor table in this tree yet, so
+	 * the child starts with none. */
+
+	_if.ds = _if.es = _if.ss = SEL_UDSEG;
+	_if.cs = SEL_UCSEG;
+	_if.eflags = FLAG_IF | FLAG_MBS;
+	args->success = load (args->cmd_line, &_if);
+	palloc_free_page (args->cmd_line);
+
+	/* ARGS lives on the parent's stack: done with it after this. */
+	if (!args->success) {
+		sema_up (&args->loaded);
+		thread_exit ();
+	}
+	sema_up (&args->loaded);
+	do_iret (&_if);
+	NOT_REACHED ();
+}
+
 /* Clones the current process as `name`. Returns the new process's thread id, or
  * TID_ERROR if the thread cannot be created. */
 tid_t
@@ -135,6 +215,12 @@ __do_fork (void *aux) {
 
 	process_activate (current);
 #ifdef VM
+	/* Pages not loaded yet are read from the executable later. */
+	if (parent->running_file != NULL) {
+		current->running_file = file_duplicate (parent->running_file);
+		if (current->running_file == NULL)
+			goto error;
+	}
 	supplemental_page_table_init (&current->spt);
 	if (!supplemental_page_table_copy (&current->spt, &parent->spt))
 		goto error;
@@ -228,6 +314,12 @@ process_cleanup (void) {
 	supplemental_page_table_kill (&curr->spt);
 #endif
 
+	exception_release_fault_stats (curr);
+
+	/* The executable stays open while its pages may still be loaded. */
+	file_close (curr->running_file);
+	curr->running_file = NULL;
+
 	uint64_t *pml4;
 	/* Destroy the current process's page directory and switch back
 	 * to the kernel-only page directory. */
@@ -272,9 +364,11 @@ process_activate (struct thread *next) {
 #define PT_PHDR    6            /* Program header table. */
 #define PT_STACK   0x6474e551   /* Stack segment. */
 
-#define PF_X 1          /* Executable. */
-#define PF_W 2          /* Writable. */
-#define PF_R 4          /* Readable. */
+/* Segment flags.  Named apart from the page fault error code bits of
+ * userprog/exception.h. */
+#define PF_ELF_X 1      /* Executable. */
+#define PF_ELF_W 2      /* Writable. */
+#define PF_ELF_R 4      /* Readable. */
 
 /* Executable header.  See [ELF1] 1-4 to 1-8.
  * This appears at the very beginning of an ELF binary. */
@@ -380,7 +474,7 @@ load (const char *file_name, struct intr_frame *if_) {
 				goto done;
 			case PT_LOAD:
 				if (validate_segment (&phdr, file)) {
-					bool writable = (phdr.p_flags & PF_W) != 0;
+					bool writable = (phdr.p_flags & PF_ELF_W) != 0;
 					uint64_t file_page = phdr.p_offset & ~PGMASK;
 					uint64_t mem_page = phdr.p_vaddr & ~PGMASK;
 					uint64_t page_offset = phdr.p_vaddr & PGMASK;
@@ -420,8 +514,14 @@ load (const char *file_name, struct intr_frame *if_) {
 	success = true;
 
 done:
-	/* We arrive here whether the load is successful or not. */
-	file_close (file);
+	/* We arrive here whether the load is successful or not.
+	 * On success the executable is kept open, and read-only, for as
+	 * long as the process runs from it. */
+	if (success) {
+		file_deny_write (file);
+		t->running_file = file;
+	} else
+		file_close (file);
 	return success;
 }
 
@@ -574,11 +674,22 @@ install_page (void *upage, void *kpage, bool writable) {
  * If you want to implement the function for only project 2, implement it on the
  * upper block. */
 
+/* Where the contents of a lazily loaded segment page come from.  The
+ * file is the executable of the page's owner, so that a forked child
+ * can copy the info as is. */
+struct lazy_load_info {
+	off_t ofs;                  /* Offset of the page within the file. */
+	size_t read_bytes;          /* Bytes to read; the rest stays zero. */
+};
+
+/* Loads the page described by AUX, a struct lazy_load_info, on its first
+ * fault.  The frame arrives zeroed from anon_initializer(). */
 static bool
 lazy_load_segment (struct page *page, void *aux) {
-	/* TODO: Load the segment from the file */
-	/* TODO: This called when the first page fault occurs on address VA. */
-	/* TODO: VA is available when calling this function. */
+	struct lazy_load_info *info = aux;
+
+	return file_read_at (page->owner->running_file, page->frame->kva,
+			info->read_bytes, info->ofs) == (off_t) info->read_bytes;
 }
 
 /* Loads a segment starting at offset OFS in FILE at address
@@ -602,23 +713,46 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
 	ASSERT (pg_ofs (upage) == 0);
 	ASSERT (ofs % PGSIZE == 0);
 
+	/* Read-only segments, such as text and read-only data, map the
+	 * file itself, so processes running the same program share the
+	 * frames through the page cache. */
+	if (!writable)
+		return file_map (upage, (read_bytes + zero_bytes) / PGSIZE, false,
+				file, ofs, read_bytes, false);
+
 	while (read_bytes > 0 || zero_bytes > 0) {
 		/* Do calculate how to fill this page.
 		 * We will read PAGE_READ_BYTES bytes from FILE
 		 * and zero the final PAGE_ZERO_BYTES bytes. */
 		size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
 		size_t page_zero_bytes = PGSIZE - page_read_bytes;
-
-		/* TODO: Set up aux to pass information to the lazy_load_segment. */
-		void *aux = NULL;
-		if (!vm_alloc_page_with_initializer (VM_ANON, upage,
-					writable, lazy_load_segment, aux))
-			return false;
+		struct lazy_load_info *aux;
+
+		/* A page of pure bss is plain anonymous memory, which reads
+		 * from the shared zero page until it is written. */
+		if (page_read_bytes == 0) {
+			if (!vm_alloc_page (VM_ANON, upage, writable))
+				return false;
+		} else {
+			aux = malloc (sizeof *aux);
+			if (aux == NULL)
+				return false;
+			aux->ofs = ofs;
+			aux->read_bytes = page_read_bytes;
+			if (!vm_alloc_page_with_initializer (VM_ANON, upage,
+						writable, lazy_load_segment, aux)) {
+				free (aux);
+				return false;
+			}
+			spt_find_page (&thread_current ()->spt, upage)->uninit.aux_size
+				= sizeof *aux;
+		}
 
 		/* Advance. */
 		read_bytes -= page_read_bytes;
 		zero_bytes -= page_zero_bytes;
 		upage += PGSIZE;
+		ofs += PGSIZE;
 	}
 	return true;
 }
@@ -629,11 +763,11 @@ setup_stack (struct intr_frame *if_) {
 	bool success = false;
 	void *stack_bottom = (void *) (((uint8_t *) USER_STACK) - PGSIZE);
 
-	/* TODO: Map the stack on stack_bottom and claim the page immediately.
-	 * TODO: If success, set the rsp accordingly.
-	 * TODO: You should mark the page is stack. */
-	/* TODO: Your code goes here */
-
+	if (vm_alloc_page (VM_ANON | VM_STACK, stack_bottom, true)
+			&& vm_claim_page (stack_bottom)) {
+		success = true;
+		if_->rsp = USER_STACK;
+	}
 	return success;
 }
 #endif /* VM */
@@ -1,12 +1,21 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <string.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/loader.h"
+#include "threads/vaddr.h"
+#include "userprog/exception.h"
 #include "userprog/gdt.h"
+#include "userprog/process.h"
 #include "threads/flags.h"
 #include "intrinsic.h"
+#ifdef VM
+#include "vm/vm.h"
+#else
+#include "threads/mmu.h"
+#endif
 
 void syscall_entry (void);
 void syscall_handler (struct intr_frame *);
@@ -37,10 +46,103 @@ syscall_init (void) {
 			FLAG_IF | FLAG_TF | FLAG_DF | FLAG_IOPL | FLAG_AC | FLAG_NT);
 }
 
+/* Returns true if the user page that contains UADDR is mapped, or
+   will be brought in by a fault. */
+static bool
+user_page_ok (const void *uaddr) {
+	struct thread *t = thread_current ();
+
+	if (uaddr == NULL || !is_user_vaddr (uaddr))
+		return false;
+#ifdef VM
+	return spt_find_page (&t->spt, pg_round_down (uaddr)) != NULL;
+#else
+	return pml4_get_page (t->pml4, uaddr) != NULL;
+#endif
+}
+
+/* Returns true if all of the SIZE bytes at UADDR are user memory that
+   the kernel can access. */
+static bool
+user_range_ok (const void *uaddr, size_t size) {
+	const uint8_t *p = pg_round_down (uaddr);
+	const uint8_t *end = (const uint8_t *) uaddr + size;
+
+	if (end < (const uint8_t *) uaddr)
+		return false;
+	for (; p < end; p += PGSIZE)
+		if (!user_page_ok (p))
+			return false;
+	return true;
+}
+
+/* Returns true if the null-terminated string at USTR, terminator
+   included, is user memory that the kernel can read. */
+static bool
+user_string_ok (const char *ustr) {
+	if (!user_page_ok (ustr))
+		return false;
+	for (; *ustr != '\0'; ustr++)
+		if (pg_ofs (ustr + 1) == 0 && !user_page_ok (ustr + 1))
+			return false;
+	return true;
+}
+
+/* Starts the program in CMD_LINE as a new process.  Fails if
+   FD_ACTIONS asks for any descriptor to be passed, since there are
+   no descriptors yet. */
+static tid_t
+spawn (const char *cmd_line, const struct spawn_fd_action *fd_actions) {
+	if (!user_string_ok (cmd_line))
+		return TID_ERROR;
+	if (fd_actions != NULL) {
+		const struct spawn_fd_action *a;
+
+		for (a = fd_actions; ; a++) {
+			if (!user_range_ok (a, sizeof *a))
+				return TID_ERROR;
+			if (a->fd == -1)
+				break;
+		}
+	}
+	return process_spawn (cmd_line, fd_actions);
+}
+
+/* Copies the page fault statistics to user buffer ST. */
+static bool
+faultstat (struct fault_stats *st, bool all) {
+	struct fault_stats buf;
+
+	if (!user_range_ok (st, sizeof *st))
+		return false;
+	exception_get_fault_stats (&buf, all);
+	memcpy (st, &buf, sizeof buf);
+	return true;
+}
+
 /* The main system call interface */
 void
-syscall_handler (struct intr_frame *f UNUSED) {
-	// TODO: Your implementation goes here.
-	printf ("system call!\n");
-	thread_exit ();
+syscall_handler (struct intr_frame *f) {
+#ifdef VM
+	/* A fault on the user stack inside a system call needs this. */
+	thread_current ()->user_rsp = (void *) f->rsp;
+#endif
+	switch (f->R.rax) {
+#ifdef VM
+		case SYS_MADVISE:
+			f->R.rax = vm_madvise ((void *) f->R.rdi, f->R.rsi, f->R.rdx);
+			break;
+#endif
+		case SYS_SPAWN:
+			f->R.rax = spawn ((const char *) f->R.rdi,
+					(const struct spawn_fd_action *) f->R.rsi);
+			break;
+		case SYS_FAULTSTAT:
+			f->R.rax = faultstat ((struct fault_stats *) f->R.rdi, f->R.rsi);
+			break;
+		default:
+			// TODO: Your implementation goes here.
+			printf ("system call!\n");
+			thread_exit ();
+	}
 }
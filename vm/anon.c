@@ -1,7 +1,15 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
+#include <bitmap.h>
+#include <lz.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
 #include "vm/vm.h"
 #include "devices/disk.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
@@ -17,11 +25,108 @@ static const struct page_operations anon_ops = {
 	.type = VM_ANON,
 };
 
+/* Sectors that make up one swap slot. */
+#define SECTORS_PER_SLOT (PGSIZE / DISK_SECTOR_SIZE)
+
+/* Number of virtually following pages brought in along with a page,
+ * when they were swapped out to the slots that follow its slot. */
+#define SWAP_READAHEAD 7
+
+/* Swap slots in use, one bit per slot.  A slot is shared by the pages
+ * of forked processes that were swapped out while sharing a frame, so
+ * SLOT_REFS counts the pages that refer to each slot in use. */
+static struct bitmap *swap_table;
+static unsigned short *slot_refs;
+static struct lock swap_lock;
+
+/* Slots reserved for the eviction round in progress.  Pages swapped
+ * out between anon_swap_cluster_begin() and anon_swap_cluster_end()
+ * take consecutive slots from [CLUSTER_NEXT, CLUSTER_END).  Only the
+ * evicting thread, which holds the eviction lock, touches these. */
+static size_t cluster_next;
+static size_t cluster_end;
+
+/* Swap statistics. */
+static long long swap_out_cnt;      /* Pages written to swap. */
+static long long swap_in_cnt;       /* Pages read from swap on a fault. */
+static long long swap_ra_cnt;       /* Pages read ahead from swap. */
+
+/* Compressed swap pool.
+ *
+ * When enabled with -zswap, evicted anonymous pages are compressed
+ * and kept in kernel memory instead of going to the swap disk, which
+ * is slow PIO.  Pages that do not shrink below ZSWAP_MAX_LEN go to the
+ * disk directly.  Once the pool would exceed zswap_pool_limit bytes
+ * of kernel memory, the pages that entered it first are written to
+ * the disk in batches.
+ * ZSWAP_LOCK guards the pool and the location (zswap entry or slot)
+ * of every swapped-out page. */
+size_t zswap_pool_limit;
+
+/* Pages written from the pool to the disk at once. */
+#define ZSWAP_WRITEBACK_BATCH 8
+
+/* A compressed page in the pool. */
+struct zswap_entry {
+	struct list_elem elem;      /* Element in zswap_lru. */
+	struct page *page;          /* Page these are the contents of. */
+	size_t len;                 /* Length of DATA. */
+	uint8_t data[];             /* Compressed contents. */
+};
+
+/* Entries are allocated with malloc(), which rounds a request up to a
+ * power of two and hands out whole pages for anything over
+ * ZSWAP_MAX_ALLOC bytes.  A page that does not compress into the
+ * largest block is not worth keeping. */
+#define ZSWAP_MAX_ALLOC 1024
+#define ZSWAP_MAX_LEN (ZSWAP_MAX_ALLOC - sizeof (struct zswap_entry))
+
+static struct list zswap_lru;       /* Entries, coldest first. */
+static struct lock zswap_lock;
+static size_t zswap_pool_bytes;     /* Bytes of memory held by entries. */
+static uint8_t zswap_buf[PGSIZE];   /* Compression and writeback scratch. */
+static uint8_t zswap_work[LZ_WORK_SIZE];
+
+/* Compressed swap statistics. */
+static long long zswap_stored_cnt;  /* Pages stored in the pool. */
+static long long zswap_reject_cnt;  /* Pages that did not compress. */
+static long long zswap_hit_cnt;     /* Swap-ins served from the pool. */
+static long long zswap_wb_cnt;      /* Pages written back to disk. */
+static long long zswap_out_bytes;   /* Memory taken by stored pages. */
+
 /* Initialize the data for anonymous pages */
 void
 vm_anon_init (void) {
-	/* TODO: Set up the swap_disk. */
-	swap_disk = NULL;
+	lock_init (&swap_lock);
+	lock_init (&zswap_lock);
+	list_init (&zswap_lru);
+	cluster_next = cluster_end = 0;
+
+	swap_disk = disk_get (1, 1);
+	if (swap_disk == NULL)
+		return;
+	swap_table = bitmap_create (disk_size (swap_disk) / SECTORS_PER_SLOT);
+	slot_refs = calloc (bitmap_size (swap_table), sizeof *slot_refs);
+	if (swap_table == NULL || slot_refs == NULL)
+		PANIC ("swap table creation failed");
+}
+
+/* Prints swap statistics. */
+void
+vm_anon_print_stats (void) {
+	printf ("Swap: %lld pages out, %lld pages in, %lld read ahead\n",
+			swap_out_cnt, swap_in_cnt, swap_ra_cnt);
+	if (zswap_pool_limit > 0) {
+		long long in_bytes = zswap_stored_cnt * PGSIZE;
+		long long swap_ins = zswap_hit_cnt + swap_in_cnt;
+
+		printf ("Zswap: %lld stored, %lld rejected, %lld written back, "
+				"%lld%% compressed size, %lld%% hit rate, %lld bytes saved\n",
+				zswap_stored_cnt, zswap_reject_cnt, zswap_wb_cnt,
+				in_bytes ? zswap_out_bytes * 100 / in_bytes : 0,
+				swap_ins ? zswap_hit_cnt * 100 / swap_ins : 0,
+				in_bytes - zswap_out_bytes);
+	}
 }
 
 /* Initialize the file mapping */
@@ -31,22 +136,333 @@ anon_initializer (struct page *page, enum vm_type type, void *kva) {
 	page->operations = &anon_ops;
 
 	struct anon_page *anon_page = &page->anon;
+	anon_page->type = type;
+	anon_page->slot = SWAP_SLOT_NONE;
+	anon_page->zswap = NULL;
+	anon_page->readahead = false;
+	anon_page->init = NULL;
+	anon_page->aux = NULL;
+	anon_page->aux_size = 0;
+
+	/* Anonymous memory starts out zeroed. */
+	memset (kva, 0, PGSIZE);
+	return true;
+}
+
+/* Reserves PAGE_CNT consecutive swap slots for the pages about to be
+ * evicted together, so that they land next to each other on disk.  If
+ * no such run is free, pages fall back to slots of their own. */
+void
+anon_swap_cluster_begin (size_t page_cnt) {
+	size_t slot;
+
+	if (swap_table == NULL || page_cnt == 0)
+		return;
+
+	lock_acquire (&swap_lock);
+	slot = bitmap_scan_and_flip (swap_table, 0, page_cnt, false);
+	lock_release (&swap_lock);
+
+	if (slot != BITMAP_ERROR) {
+		cluster_next = slot;
+		cluster_end = slot + page_cnt;
+	}
+}
+
+/* Returns the slots of the current cluster that went unused. */
+void
+anon_swap_cluster_end (void) {
+	if (cluster_next < cluster_end) {
+		lock_acquire (&swap_lock);
+		bitmap_set_multiple (swap_table, cluster_next,
+				cluster_end - cluster_next, false);
+		lock_release (&swap_lock);
+	}
+	cluster_next = cluster_end = 0;
+}
+
+/* Allocates CNT consecutive swap slots and returns the first, or
+ * SWAP_SLOT_NONE if there is no such run. */
+static size_t
+swap_slots_alloc (size_t cnt) {
+	size_t slot;
+
+	if (swap_table == NULL)
+		return SWAP_SLOT_NONE;
+
+	lock_acquire (&swap_lock);
+	slot = bitmap_scan_and_flip (swap_table, 0, cnt, false);
+	if (slot != BITMAP_ERROR) {
+		size_t i;
+
+		for (i = 0; i < cnt; i++)
+			slot_refs[slot + i] = 1;
+	}
+	lock_release (&swap_lock);
+	return slot != BITMAP_ERROR ? slot : SWAP_SLOT_NONE;
+}
+
+/* Returns a free swap slot, or SWAP_SLOT_NONE if swap is full. */
+static size_t
+swap_slot_alloc (void) {
+	if (cluster_next < cluster_end) {
+		slot_refs[cluster_next] = 1;
+		return cluster_next++;
+	}
+	return swap_slots_alloc (1);
+}
+
+/* Writes the page at KVA to swap slot SLOT. */
+static void
+swap_write (size_t slot, const void *kva) {
+	size_t i;
+
+	for (i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_write (swap_disk, slot * SECTORS_PER_SLOT + i,
+				kva + i * DISK_SECTOR_SIZE);
+}
+
+/* Returns the bytes of memory that malloc() sets aside for an entry
+ * holding LEN bytes of compressed data. */
+static size_t
+zswap_alloc_size (size_t len) {
+	size_t size = 16;
+
+	while (size < sizeof (struct zswap_entry) + len)
+		size *= 2;
+	return size;
+}
+
+/* Writes up to ZSWAP_WRITEBACK_BATCH of the coldest pages in the pool
+ * to consecutive swap slots and drops them from the pool.  Returns
+ * false if not a single page could be written. */
+static bool
+zswap_writeback (void) {
+	size_t cnt = list_size (&zswap_lru);
+	size_t slot;
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&zswap_lock));
+
+	if (cnt > ZSWAP_WRITEBACK_BATCH)
+		cnt = ZSWAP_WRITEBACK_BATCH;
+	slot = swap_slots_alloc (cnt);
+	if (slot == SWAP_SLOT_NONE && cnt > 1) {
+		cnt = 1;
+		slot = swap_slots_alloc (cnt);
+	}
+	if (slot == SWAP_SLOT_NONE)
+		return false;
+
+	for (i = 0; i < cnt; i++) {
+		struct zswap_entry *entry = list_entry (list_pop_front (&zswap_lru),
+				struct zswap_entry, elem);
+
+		if (lz_decompress (entry->data, entry->len, zswap_buf, PGSIZE) != PGSIZE)
+			PANIC ("zswap: corrupted entry");
+		swap_write (slot + i, zswap_buf);
+		entry->page->anon.slot = slot + i;
+		entry->page->anon.zswap = NULL;
+		zswap_pool_bytes -= zswap_alloc_size (entry->len);
+		free (entry);
+		zswap_wb_cnt++;
+		swap_out_cnt++;
+	}
+	return true;
+}
+
+/* Compresses PAGE into the pool, making room by writing older pages
+ * to disk if needed.  Returns false if PAGE should go to the swap disk
+ * instead. */
+static bool
+zswap_store (struct page *page) {
+	struct zswap_entry *entry;
+	size_t len, size;
+
+	lock_acquire (&zswap_lock);
+	len = lz_compress (page->frame->kva, PGSIZE, zswap_buf, ZSWAP_MAX_LEN,
+			zswap_work);
+	if (len == 0) {
+		zswap_reject_cnt++;
+		goto fail;
+	}
+	size = zswap_alloc_size (len);
+	entry = malloc (sizeof *entry + len);
+	if (entry == NULL)
+		goto fail;
+	memcpy (entry->data, zswap_buf, len);
+	entry->page = page;
+	entry->len = len;
+
+	while (zswap_pool_bytes + size > zswap_pool_limit)
+		if (list_empty (&zswap_lru) || !zswap_writeback ()) {
+			free (entry);
+			goto fail;
+		}
+
+	list_push_back (&zswap_lru, &entry->elem);
+	zswap_pool_bytes += size;
+	page->anon.zswap = entry;
+	zswap_stored_cnt++;
+	zswap_out_bytes += size;
+	lock_release (&zswap_lock);
+	return true;
+
+fail:
+	lock_release (&zswap_lock);
+	return false;
+}
+
+/* Drops a reference to SLOT, marking it free after the last one. */
+static void
+swap_slot_free (size_t slot) {
+	lock_acquire (&swap_lock);
+	ASSERT (bitmap_test (swap_table, slot));
+	ASSERT (slot_refs[slot] > 0);
+	if (--slot_refs[slot] == 0)
+		bitmap_reset (swap_table, slot);
+	lock_release (&swap_lock);
+}
+
+/* Makes DST, a page of a forked process or another mapper of the frame
+ * SRC was evicted from, refer to a copy of the swapped-out contents of
+ * SRC.  DST must not refer to swap itself.  A swap slot is shared; a compressed
+ * copy is duplicated, since the pool tracks one page per entry.
+ * Returns false if memory ran out. */
+bool
+anon_swap_dup (struct page *dst, struct page *src) {
+	struct anon_page *anon_page = &src->anon;
+	bool success = true;
+
+	lock_acquire (&zswap_lock);
+	if (anon_page->zswap != NULL) {
+		struct zswap_entry *entry = anon_page->zswap;
+		struct zswap_entry *copy = malloc (sizeof *copy + entry->len);
+
+		if (copy != NULL) {
+			memcpy (copy, entry, sizeof *copy + entry->len);
+			copy->page = dst;
+			list_push_back (&zswap_lru, &copy->elem);
+			zswap_pool_bytes += zswap_alloc_size (copy->len);
+			dst->anon.zswap = copy;
+		} else
+			success = false;
+	} else if (anon_page->slot != SWAP_SLOT_NONE) {
+		lock_acquire (&swap_lock);
+		slot_refs[anon_page->slot]++;
+		lock_release (&swap_lock);
+		dst->anon.slot = anon_page->slot;
+	}
+	lock_release (&zswap_lock);
+	return success;
+}
+
+/* Brings in the virtual neighbours of PAGE that were swapped out to
+ * the slots right after SLOT, as long as free frames are at hand. */
+static void
+swap_readahead (struct page *page, size_t slot) {
+	struct supplemental_page_table *spt = &page->owner->spt;
+	size_t i;
+
+	for (i = 1; i <= SWAP_READAHEAD; i++) {
+		struct page *next = spt_find_page (spt, page->va + i * PGSIZE);
+
+		if (next == NULL || next->operations != &anon_ops
+				|| next->frame != NULL || next->anon.slot != slot + i)
+			break;
+
+		next->anon.readahead = true;
+		if (!vm_try_claim_page (next)) {
+			next->anon.readahead = false;
+			break;
+		}
+		swap_ra_cnt++;
+	}
 }
 
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
 	struct anon_page *anon_page = &page->anon;
+	struct zswap_entry *entry;
+	bool readahead = anon_page->readahead;
+	size_t slot;
+	size_t i;
+
+	lock_acquire (&zswap_lock);
+	entry = anon_page->zswap;
+	if (entry != NULL) {
+		bool success;
+
+		list_remove (&entry->elem);
+		zswap_pool_bytes -= zswap_alloc_size (entry->len);
+		anon_page->zswap = NULL;
+		anon_page->readahead = false;
+		lock_release (&zswap_lock);
+
+		success = lz_decompress (entry->data, entry->len, kva, PGSIZE) == PGSIZE;
+		free (entry);
+		zswap_hit_cnt++;
+		return success;
+	}
+	slot = anon_page->slot;
+	lock_release (&zswap_lock);
+
+	if (slot == SWAP_SLOT_NONE)
+		return false;
+
+	for (i = 0; i < SECTORS_PER_SLOT; i++)
+		disk_read (swap_disk, slot * SECTORS_PER_SLOT + i,
+				kva + i * DISK_SECTOR_SIZE);
+	swap_slot_free (slot);
+	anon_page->slot = SWAP_SLOT_NONE;
+	anon_page->readahead = false;
+
+	if (!readahead) {
+		swap_in_cnt++;
+		if (page->advice != MADV_RANDOM)
+			swap_readahead (page, slot);
+	}
+	return true;
 }
 
 /* Swap out the page by writing contents to the swap disk. */
 static bool
 anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+	size_t slot;
+
+	/* A frame shared after fork goes to disk, where its mappers can
+	 * share the slot. */
+	if (zswap_pool_limit > 0 && list_size (&page->frame->mappers) == 1
+			&& zswap_store (page))
+		return true;
+
+	slot = swap_slot_alloc ();
+	if (slot == SWAP_SLOT_NONE)
+		return false;
+	swap_write (slot, page->frame->kva);
+	anon_page->slot = slot;
+	swap_out_cnt++;
+	return true;
 }
 
 /* Destroy the anonymous page. PAGE will be freed by the caller. */
 static void
 anon_destroy (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
+
+	vm_unlink_frame (page);
+
+	lock_acquire (&zswap_lock);
+	if (anon_page->zswap != NULL) {
+		list_remove (&anon_page->zswap->elem);
+		zswap_pool_bytes -= zswap_alloc_size (anon_page->zswap->len);
+		free (anon_page->zswap);
+		anon_page->zswap = NULL;
+	}
+	if (anon_page->slot != SWAP_SLOT_NONE)
+		swap_slot_free (anon_page->slot);
+	lock_release (&zswap_lock);
+	free (anon_page->aux);
 }
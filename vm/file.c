@@ -1,5 +1,14 @@
 /* file.c: Implementation of memory backed file object (mmaped object). */
 
+#include <round.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 
 static bool file_backed_swap_in (struct page *page, void *kva);
@@ -14,45 +23,329 @@ static const struct page_operations file_ops = {
 	.type = VM_FILE,
 };
 
+/* Guards the reference counts of mmap regions, which are shared by
+ * processes that forked. */
+static struct lock mmap_lock;
+
+/* Most pages written back with one write, see file_writeback(). */
+#define WRITEBACK_RUN_MAX 8
+
+/* Write-back statistics. */
+static long long writeback_page_cnt;    /* Dirty pages written back. */
+static long long writeback_write_cnt;   /* Writes issued for them. */
+
 /* The initializer of file vm */
 void
 vm_file_init (void) {
+	lock_init (&mmap_lock);
+}
+
+/* Prints write-back statistics. */
+void
+vm_file_print_stats (void) {
+	printf ("Writeback: %lld pages in %lld writes\n",
+			writeback_page_cnt, writeback_write_cnt);
 }
 
 /* Initialize the file backed page */
 bool
-file_backed_initializer (struct page *page, enum vm_type type, void *kva) {
+file_backed_initializer (struct page *page, enum vm_type type UNUSED,
+		void *kva UNUSED) {
 	/* Set up the handler */
 	page->operations = &file_ops;
 
 	struct file_page *file_page = &page->file;
+
+	/* The lazy loader fills in the backing store. */
+	file_page->file = NULL;
+	file_page->offset = 0;
+	file_page->read_bytes = 0;
+	file_page->map = NULL;
+	return true;
+}
+
+/* Takes another reference to the region of PAGE, which was just
+ * copied into a forked process. */
+void
+file_backed_dup (struct page *page) {
+	if (page->file.map != NULL) {
+		lock_acquire (&mmap_lock);
+		page->file.map->ref_cnt++;
+		lock_release (&mmap_lock);
+	}
 }
 
 /* Swap in the page by read contents from the file. */
 static bool
 file_backed_swap_in (struct page *page, void *kva) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+
+	if (file_read_at (file_page->file, kva, file_page->read_bytes,
+				file_page->offset) != (off_t) file_page->read_bytes)
+		return false;
+	memset (kva + file_page->read_bytes, 0, PGSIZE - file_page->read_bytes);
+	return true;
 }
 
-/* Swap out the page by writeback contents to the file. */
+/* Swap out the page by writeback contents to the file.
+ * The frame may be shared through the page cache, so it is dirty if
+ * any of its mappers wrote to it. */
 static bool
 file_backed_swap_out (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	struct list *mappers = &page->frame->mappers;
+	bool dirty = false;
+	struct list_elem *e;
+
+	for (e = list_begin (mappers); e != list_end (mappers); e = list_next (e)) {
+		struct page *p = list_entry (e, struct page, mapper_elem);
+		dirty = dirty || pml4_is_dirty (p->owner->pml4, p->va);
+	}
+
+	/* Clean pages are simply dropped; the file still has them. */
+	if (dirty) {
+		if (file_write_at (file_page->file, page->frame->kva,
+					file_page->read_bytes, file_page->offset)
+				!= (off_t) file_page->read_bytes)
+			return false;
+		for (e = list_begin (mappers); e != list_end (mappers);
+				e = list_next (e)) {
+			struct page *p = list_entry (e, struct page, mapper_elem);
+			pml4_set_dirty (p->owner->pml4, p->va, false);
+		}
+	}
+	return true;
 }
 
 /* Destory the file backed page. PAGE will be freed by the caller. */
 static void
 file_backed_destroy (struct page *page) {
-	struct file_page *file_page UNUSED = &page->file;
+	struct file_page *file_page = &page->file;
+	struct mmap_file *map = file_page->map;
+
+	vm_unlink_frame (page);
+
+	if (map != NULL) {
+		bool last;
+
+		lock_acquire (&mmap_lock);
+		last = --map->ref_cnt == 0;
+		lock_release (&mmap_lock);
+		if (last) {
+			file_close (map->file);
+			free (map);
+		}
+	}
+}
+
+/* Maps PAGE_CNT pages at ADDR to FILE, starting at OFFSET.  The first
+ * READ_BYTES bytes come from FILE and the rest of the pages are zero.
+ * README turns on the readahead of vm_mmap_readahead() for the region.
+ * Returns false if any of the pages is taken or memory runs out. */
+bool
+file_map (void *addr, size_t page_cnt, bool writable, struct file *file,
+		off_t offset, size_t read_bytes, bool readahead) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct mmap_file *map;
+	size_t i;
+
+	for (i = 0; i < page_cnt; i++)
+		if (spt_find_page (spt, addr + i * PGSIZE) != NULL)
+			return false;
+
+	map = malloc (sizeof *map);
+	if (map == NULL)
+		return false;
+	map->file = file_reopen (file);
+	if (map->file == NULL) {
+		free (map);
+		return false;
+	}
+	map->addr = addr;
+	map->page_cnt = page_cnt;
+	map->ref_cnt = 0;
+	map->readahead = readahead;
+	map->mmapped = false;
+	/* No history yet, so the first fault reads only its own page. */
+	map->ra_next = NULL;
+	map->ra_size = 0;
+	map->ra_marker = NULL;
+
+	/* The pages need no lazy loader of their own: a file page that is
+	 * not resident is read from its file on the next fault anyway. */
+	for (i = 0; i < page_cnt; i++) {
+		void *upage = addr + i * PGSIZE;
+		size_t page_ofs = i * PGSIZE;
+		struct page *page;
+
+		if (!vm_alloc_page (VM_FILE, upage, writable))
+			break;
+		page = spt_find_page (spt, upage);
+		file_backed_initializer (page, VM_FILE, NULL);
+		page->file.file = map->file;
+		page->file.offset = offset + page_ofs;
+		page->file.read_bytes = page_ofs < read_bytes
+			? (read_bytes - page_ofs < PGSIZE ? read_bytes - page_ofs : PGSIZE)
+			: 0;
+		page->file.map = map;
+		map->ref_cnt++;
+	}
+	if (i < page_cnt) {
+		/* Removing the last page drops the region as well. */
+		if (i == 0) {
+			file_close (map->file);
+			free (map);
+		}
+		while (i-- > 0)
+			spt_remove_page (spt, spt_find_page (spt, addr + i * PGSIZE));
+		return false;
+	}
+	return true;
 }
 
 /* Do the mmap */
 void *
 do_mmap (void *addr, size_t length, int writable,
 		struct file *file, off_t offset) {
+	off_t file_len;
+	size_t read_len;
+
+	if (addr == NULL || pg_ofs (addr) != 0 || length == 0
+			|| offset < 0 || pg_ofs (offset) != 0
+			|| (uint64_t) addr + length < (uint64_t) addr
+			|| !is_user_vaddr (addr) || !is_user_vaddr (addr + length - 1))
+		return NULL;
+	file_len = file_length (file);
+	if (file_len <= offset)
+		return NULL;
+	read_len = (size_t) (file_len - offset) < length
+		? (size_t) (file_len - offset) : length;
+
+	if (!file_map (addr, DIV_ROUND_UP (length, PGSIZE), writable, file, offset,
+				read_len, true))
+		return NULL;
+	spt_find_page (&thread_current ()->spt, addr)->file.map->mmapped = true;
+	return addr;
+}
+
+/* Orders pages by inode and then by offset. */
+static int
+writeback_cmp (const void *a_, const void *b_) {
+	const struct page *a = *(struct page * const *) a_;
+	const struct page *b = *(struct page * const *) b_;
+	struct inode *ia = file_get_inode (a->file.file);
+	struct inode *ib = file_get_inode (b->file.file);
+
+	if (ia != ib)
+		return ia < ib ? -1 : 1;
+	return a->file.offset < b->file.offset ? -1 : a->file.offset > b->file.offset;
+}
+
+/* Returns true if NEXT continues the run of file data that ends with
+ * PREV, so both can go out in one write. */
+static bool
+writeback_adjacent (const struct page *prev, const struct page *next) {
+	return file_get_inode (prev->file.file) == file_get_inode (next->file.file)
+		&& prev->file.read_bytes == PGSIZE
+		&& prev->file.offset + PGSIZE == next->file.offset;
+}
+
+/* Writes back those of the CNT file-backed PAGES that were modified.
+ * Clean pages cost nothing.  The dirty ones are sorted by file offset
+ * and runs of adjacent pages go out in a single write of up to
+ * WRITEBACK_RUN_MAX pages, gathered in a bounce buffer.  A page that
+ * a short write did not fully cover is marked dirty again, so it is
+ * retried on the next write-back.  PAGES is reordered. */
+void
+file_writeback (struct page **pages, size_t cnt) {
+	uint8_t *buf;
+	size_t dirty_cnt = 0;
+	size_t i, j;
+
+	for (i = 0; i < cnt; i++)
+		if (vm_pin_dirty_page (pages[i]))
+			pages[dirty_cnt++] = pages[i];
+	if (dirty_cnt == 0)
+		return;
+	qsort (pages, dirty_cnt, sizeof *pages, writeback_cmp);
+
+	/* Without a buffer every page is a run of its own. */
+	buf = dirty_cnt > 1 ? palloc_get_multiple (0, WRITEBACK_RUN_MAX) : NULL;
+
+	for (i = 0; i < dirty_cnt; i = j) {
+		struct page *first = pages[i];
+		size_t len = first->file.read_bytes;
+		off_t written;
+
+		for (j = i + 1; buf != NULL && j < dirty_cnt
+				&& j - i < WRITEBACK_RUN_MAX
+				&& writeback_adjacent (pages[j - 1], pages[j]); j++)
+			len += pages[j]->file.read_bytes;
+
+		if (j - i == 1)
+			written = file_write_at (first->file.file, first->frame->kva, len,
+					first->file.offset);
+		else {
+			size_t k;
+
+			for (k = i; k < j; k++)
+				memcpy (buf + (k - i) * PGSIZE, pages[k]->frame->kva,
+						pages[k]->file.read_bytes);
+			written = file_write_at (first->file.file, buf, len,
+					first->file.offset);
+		}
+		writeback_write_cnt++;
+		writeback_page_cnt += j - i;
+
+		for (; i < j; i++) {
+			struct page *page = pages[i];
+			size_t end = (page->file.offset - first->file.offset)
+				+ page->file.read_bytes;
+
+			if (written < 0 || (size_t) written < end)
+				pml4_set_dirty (page->owner->pml4, page->va, true);
+			vm_unpin_page (page);
+		}
+	}
+	palloc_free_multiple (buf, WRITEBACK_RUN_MAX);
 }
 
 /* Do the munmap */
 void
 do_munmap (void *addr) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *page = spt_find_page (spt, addr);
+	struct mmap_file *map;
+	struct page **pages;
+	size_t page_cnt, cnt = 0;
+	size_t i;
+
+	/* Only regions made by mmap(), not the executable's own segments. */
+	if (page == NULL || VM_TYPE (page->operations->type) != VM_FILE
+			|| page->file.map == NULL || !page->file.map->mmapped
+			|| page->file.map->addr != addr)
+		return;
+
+	/* Removing the last page frees MAP. */
+	map = page->file.map;
+	page_cnt = map->page_cnt;
+
+	pages = malloc (page_cnt * sizeof *pages);
+	if (pages != NULL) {
+		for (i = 0; i < page_cnt; i++) {
+			page = spt_find_page (spt, addr + i * PGSIZE);
+			if (page != NULL && VM_TYPE (page->operations->type) == VM_FILE
+					&& page->file.map == map && page->frame != NULL)
+				pages[cnt++] = page;
+		}
+		file_writeback (pages, cnt);
+		free (pages);
+	}
+
+	for (i = 0; i < page_cnt; i++) {
+		page = spt_find_page (spt, addr + i * PGSIZE);
+		if (page != NULL && VM_TYPE (page->operations->type) == VM_FILE
+				&& page->file.map == map)
+			spt_remove_page (spt, page);
+	}
 }
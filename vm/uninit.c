@@ -8,6 +8,7 @@
  * function.
  * */
 
+#include "threads/malloc.h"
 #include "vm/vm.h"
 #include "vm/uninit.h"
 
@@ -49,11 +50,22 @@ uninit_initialize (struct page *page, void *kva) {
 
 	/* Fetch first, page_initialize may overwrite the values */
 	vm_initializer *init = uninit->init;
+	enum vm_type type = uninit->type;
 	void *aux = uninit->aux;
+	size_t aux_size = uninit->aux_size;
 
-	/* TODO: You may need to fix this function. */
-	return uninit->page_initializer (page, uninit->type, kva) &&
+	/* AUX belongs to the page; INIT copies out whatever it needs. */
+	bool success = uninit->page_initializer (page, type, kva) &&
 		(init ? init (page, aux) : true);
+
+	/* An anonymous page keeps a loader it can be rebuilt from. */
+	if (success && VM_TYPE (type) == VM_ANON && init != NULL && aux_size > 0) {
+		page->anon.init = init;
+		page->anon.aux = aux;
+		page->anon.aux_size = aux_size;
+	} else
+		free (aux);
+	return success;
 }
 
 /* Free the resources hold by uninit_page. Although most of pages are transmuted
@@ -62,7 +74,9 @@ uninit_initialize (struct page *page, void *kva) {
  * PAGE will be freed by the caller. */
 static void
 uninit_destroy (struct page *page) {
-	struct uninit_page *uninit UNUSED = &page->uninit;
-	/* TODO: Fill this function.
-	 * TODO: If you don't have anything to do, just return. */
+	struct uninit_page *uninit = &page->uninit;
+
+	/* The page may still map the zero page. */
+	vm_unlink_frame (page);
+	free (uninit->aux);
 }
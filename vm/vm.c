@@ -1,9 +1,112 @@
 /* vm.c: Generic interface for virtual memory objects. */
 
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall-nr.h>
+#include "intrinsic.h"
+#include "devices/timer.h"
 #include "threads/malloc.h"
+#include "threads/mmu.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
 #include "vm/vm.h"
 #include "vm/inspect.h"
 
+/* Frame table.
+ *
+ * Every frame handed out from the user pool is kept on FRAME_TABLE.
+ * The list is treated as a ring and CLOCK_HAND points at the frame
+ * that was examined last by the eviction policy.  FRAME_LOCK guards
+ * the table, the hand and the mapper lists of every frame.  It is not
+ * held while a victim is written out: the victim is pinned and marked
+ * evicting instead, and whoever would tear down or share one of its
+ * pages waits on EVICT_COND.  EVICT_LOCK lets one thread evict at a
+ * time, which keeps the swap cluster of anon.c to that thread. */
+static struct list frame_table;
+static struct list_elem *clock_hand;
+static struct lock frame_lock;
+static struct condition evict_cond;
+static struct lock evict_lock;
+static size_t frame_cnt;
+
+/* Eviction statistics. */
+static long long evict_cnt;         /* Number of frames evicted. */
+static long long evict_scan_cnt;    /* Frames examined by the clock. */
+static long long evict_scan_max;    /* Longest single scan. */
+
+/* The zero page.  Read faults on anonymous pages that were never
+ * written map this one zero-filled frame read-only; the first write
+ * gives the page a frame of its own.  The frame is not in the frame
+ * table, so it is never evicted, and it stays pinned so that losing
+ * its last mapper does not free it. */
+static struct frame zero_frame;
+static long long zero_map_cnt;      /* Read faults served by it. */
+static long long zero_upgrade_cnt;  /* Pages that wrote to it later. */
+
+/* Same-page merging, see ksmd().  KSM_TABLE holds anonymous frames by
+ * a checksum of their contents and KSM_CURSOR is the last frame the
+ * scanner looked at.  Both are guarded by FRAME_LOCK. */
+size_t ksm_pages_to_scan;
+unsigned ksm_sleep_ms = 100;
+static struct hash ksm_table;
+static struct list_elem *ksm_cursor;
+static long long ksm_scan_cnt;      /* Frames examined. */
+static long long ksm_merge_cnt;     /* Frames merged away, and so saved. */
+static long long ksm_share_cnt;     /* Frames that others merged into. */
+static hash_hash_func ksm_hash;
+static hash_less_func ksm_less;
+static thread_func ksmd;
+
+/* Stack growth, see vm_stack_growth(). */
+size_t vm_stack_limit = 1024 * 1024;
+#define STACK_AHEAD_MAX 16
+static long long stack_growth_cnt;  /* Faults that grew the stack. */
+static long long stack_ahead_cnt;   /* Pages brought in ahead of use. */
+
+/* Page cache of file-backed frames, keyed by inode and offset.
+ * Guarded by FRAME_LOCK along with the rest of the frame table. */
+static struct hash page_cache;
+static size_t page_cache_cnt;       /* Frames in the page cache. */
+static long long page_cache_hit_cnt; /* Faults served by a cached frame. */
+static hash_hash_func cache_hash;
+static hash_less_func cache_less;
+
+/* Pages in the fault-around window, including the faulting page.
+ * Up to FAULT_AROUND_MAX; 1 turns fault-around off. */
+size_t vm_fault_around_pages = 8;
+static long long fault_around_cnt;  /* Faults avoided by fault-around. */
+
+/* Readahead statistics. */
+static long long ra_page_cnt;       /* Pages read ahead. */
+static long long ra_marker_cnt;     /* Windows started by a marker. */
+static long long ra_collapse_cnt;   /* Windows dropped on random access. */
+
+/* madvise() statistics. */
+static long long madvise_prefetch_cnt; /* Pages brought in by WILLNEED. */
+static long long madvise_drop_cnt;  /* Pages dropped by DONTNEED. */
+
+/* Copy-on-write statistics. */
+static long long cow_share_cnt;     /* Frames shared by fork. */
+static long long cow_copy_cnt;      /* Write faults that copied a frame. */
+static long long cow_reuse_cnt;     /* Write faults that kept the frame. */
+
+/* Maximum number of frames evicted in one round. */
+#define EVICT_BATCH 8
+
+/* Background reclaim, see kswapd().  The watermarks are set from the
+ * size of the user pool by vm_init(). */
+static size_t user_pool_cnt;        /* Pages in the user pool. */
+static size_t reclaim_low;          /* Wake kswapd below this many. */
+static size_t reclaim_high;         /* kswapd stops at this many. */
+static struct semaphore kswapd_sema;
+static bool kswapd_awake;           /* Woken and not done yet. */
+static long long kswapd_wake_cnt;   /* Times kswapd was woken. */
+static long long kswapd_reclaim_cnt; /* Frames kswapd evicted. */
+static long long direct_reclaim_cnt; /* Evictions done by a fault. */
+static long long direct_reclaim_cycles; /* TSC cycles spent in them. */
+static thread_func kswapd;
+
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
 void
@@ -15,7 +118,66 @@ vm_init (void) {
 #endif
 	register_inspect_intr ();
 	/* DO NOT MODIFY UPPER LINES. */
-	/* TODO: Your code goes here. */
+	list_init (&frame_table);
+	lock_init (&frame_lock);
+	cond_init (&evict_cond);
+	lock_init (&evict_lock);
+
+	user_pool_cnt = palloc_free_cnt (PAL_USER);
+	reclaim_low = user_pool_cnt / 32 > EVICT_BATCH
+		? user_pool_cnt / 32 : EVICT_BATCH;
+	reclaim_high = reclaim_low * 2;
+	sema_init (&kswapd_sema, 0);
+	kswapd_awake = false;
+	thread_create ("kswapd", PRI_DEFAULT, kswapd, NULL);
+
+	hash_init (&ksm_table, ksm_hash, ksm_less, NULL);
+	ksm_cursor = NULL;
+	if (ksm_pages_to_scan > 0)
+		thread_create ("ksmd", PRI_MIN, ksmd, NULL);
+	hash_init (&page_cache, cache_hash, cache_less, NULL);
+
+	zero_frame.kva = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+	zero_frame.page = NULL;
+	list_init (&zero_frame.mappers);
+	zero_frame.pinned = true;
+	zero_frame.evicting = false;
+	zero_frame.inode = NULL;
+	zero_frame.ksm_listed = false;
+	clock_hand = NULL;
+}
+
+/* Prints virtual memory statistics. */
+void
+vm_print_stats (void) {
+	printf ("VM: %zu frames, %lld evictions, %lld frames scanned "
+			"(max %lld per eviction)\n",
+			frame_cnt, evict_cnt, evict_scan_cnt, evict_scan_max);
+	printf ("Fault-around: %lld faults avoided (window %zu pages)\n",
+			fault_around_cnt, vm_fault_around_pages);
+	printf ("Readahead: %lld pages read ahead, %lld marker hits, "
+			"%lld windows collapsed\n",
+			ra_page_cnt, ra_marker_cnt, ra_collapse_cnt);
+	printf ("Reclaim: kswapd woken %lld times, %lld frames reclaimed; "
+			"%lld direct reclaims, %lld cycles (avg %lld)\n",
+			kswapd_wake_cnt, kswapd_reclaim_cnt, direct_reclaim_cnt,
+			direct_reclaim_cycles,
+			direct_reclaim_cnt ? direct_reclaim_cycles / direct_reclaim_cnt : 0);
+	printf ("Zero page: %lld read faults, %lld upgraded on write\n",
+			zero_map_cnt, zero_upgrade_cnt);
+	printf ("Page cache: %zu frames, %lld hits\n",
+			page_cache_cnt, page_cache_hit_cnt);
+	printf ("Stack: %lld growth faults, %lld faults saved\n",
+			stack_growth_cnt, stack_ahead_cnt);
+	printf ("madvise: %lld pages prefetched, %lld dropped\n",
+			madvise_prefetch_cnt, madvise_drop_cnt);
+	printf ("KSM: %lld frames scanned, %lld merged into %lld, "
+			"%zu frames listed\n",
+			ksm_scan_cnt, ksm_merge_cnt, ksm_share_cnt, hash_size (&ksm_table));
+	printf ("COW: %lld frames shared, %lld copied, %lld reused\n",
+			cow_share_cnt, cow_copy_cnt, cow_reuse_cnt);
+	vm_anon_print_stats ();
+	vm_file_print_stats ();
 }
 
 /* Get the type of the page. This function is useful if you want to know the
@@ -34,8 +196,14 @@ page_get_type (struct page *page) {
 
 /* Helpers */
 static struct frame *vm_get_victim (void);
-static bool vm_do_claim_page (struct page *page);
+static bool vm_do_claim_page (struct page *page, bool evict);
+static void vm_unclaim_page (struct page *page);
+static size_t vm_load_pages (struct page **pages, size_t cnt,
+		struct page *marker);
 static struct frame *vm_evict_frame (void);
+static void vm_cache_remove (struct frame *frame);
+static void ksm_unlist (struct frame *frame);
+static void vm_free_frame (struct frame *frame);
 
 /* Create the pending page object with initializer. If you want to create a
  * page, do not create it directly and make it through this function or
@@ -50,11 +218,33 @@ vm_alloc_page_with_initializer (enum vm_type type, void *upage, bool writable,
 
 	/* Check wheter the upage is already occupied or not. */
 	if (spt_find_page (spt, upage) == NULL) {
-		/* TODO: Create the page, fetch the initialier according to the VM type,
-		 * TODO: and then create "uninit" page struct by calling uninit_new. You
-		 * TODO: should modify the field after calling the uninit_new. */
+		bool (*initializer) (struct page *, enum vm_type, void *);
+		struct page *page;
+
+		switch (VM_TYPE (type)) {
+			case VM_ANON:
+				initializer = anon_initializer;
+				break;
+			case VM_FILE:
+				initializer = file_backed_initializer;
+				break;
+			default:
+				goto err;
+		}
+
+		page = malloc (sizeof *page);
+		if (page == NULL)
+			goto err;
+		uninit_new (page, upage, init, type, aux, initializer);
+		page->writable = writable;
+		page->owner = thread_current ();
+		page->advice = MADV_NORMAL;
 
-		/* TODO: Insert the page into the spt. */
+		if (!spt_insert_page (spt, page)) {
+			free (page);
+			goto err;
+		}
+		return true;
 	}
 err:
 	return false;
@@ -62,82 +252,1084 @@ err:
 
 /* Find VA from spt and return page. On error, return NULL. */
 struct page *
-spt_find_page (struct supplemental_page_table *spt UNUSED, void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function. */
+spt_find_page (struct supplemental_page_table *spt, void *va) {
+	struct page key;
+	struct hash_elem *e;
 
-	return page;
+	key.va = pg_round_down (va);
+	e = hash_find (&spt->pages, &key.spt_elem);
+	return e != NULL ? hash_entry (e, struct page, spt_elem) : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
 bool
-spt_insert_page (struct supplemental_page_table *spt UNUSED,
-		struct page *page UNUSED) {
-	int succ = false;
-	/* TODO: Fill this function. */
+spt_insert_page (struct supplemental_page_table *spt,
+		struct page *page) {
+	ASSERT (pg_ofs (page->va) == 0);
 
-	return succ;
+	return hash_insert (&spt->pages, &page->spt_elem) == NULL;
 }
 
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
+	hash_delete (&spt->pages, &page->spt_elem);
 	vm_dealloc_page (page);
-	return true;
 }
 
-/* Get the struct frame, that will be evicted. */
+/* Returns true if more than one page maps FRAME, which is the case
+ * for frames shared copy-on-write after a fork.  The length of the
+ * mapper list is the reference count of the frame. */
+static bool
+frame_is_shared (struct frame *frame) {
+	return list_front (&frame->mappers) != list_back (&frame->mappers);
+}
+
+/* Maps PAGE to KVA, writable only if PAGE is writable and does not
+ * share the frame with anyone.  File-backed frames are the exception:
+ * all of their mappers see the same file, so they share writes too.
+ * The dirty bit of an existing mapping is kept. */
+static void
+page_map (struct page *page, void *kva) {
+	uint64_t *pml4 = page->owner->pml4;
+	bool dirty = pml4_is_dirty (pml4, page->va);
+
+	pml4_clear_page (pml4, page->va);
+	pml4_set_page (pml4, page->va, kva, page->writable
+			&& (page_get_type (page) == VM_FILE
+				|| !frame_is_shared (page->frame)));
+	pml4_set_dirty (pml4, page->va, dirty);
+}
+
+/* Returns true if PAGE is an initialized file-backed page, whose
+ * frame can be shared through the page cache. */
+static bool
+page_is_cacheable (struct page *page) {
+	return VM_TYPE (page->operations->type) == VM_FILE
+		&& page->file.file != NULL;
+}
+
+/* Drops FRAME from the page cache, if it is there. */
+static void
+vm_cache_remove (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (frame->inode != NULL) {
+		hash_delete (&page_cache, &frame->cache_elem);
+		frame->inode = NULL;
+		page_cache_cnt--;
+	}
+}
+
+/* Adds the frame PAGE was just loaded into to the page cache, unless
+ * another frame holds the same page already. */
+static void
+vm_cache_insert (struct page *page) {
+	struct frame *frame = page->frame;
+
+	if (!page_is_cacheable (page))
+		return;
+
+	lock_acquire (&frame_lock);
+	frame->inode = file_get_inode (page->file.file);
+	frame->offset = page->file.offset;
+	frame->read_bytes = page->file.read_bytes;
+	if (hash_insert (&page_cache, &frame->cache_elem) == NULL)
+		page_cache_cnt++;
+	else
+		frame->inode = NULL;
+	lock_release (&frame_lock);
+}
+
+/* Maps PAGE to a frame of the page cache that holds its contents
+ * already, if there is one.  A frame on its way in or out is left
+ * alone.  Returns true if PAGE was mapped. */
+static bool
+vm_cache_share (struct page *page) {
+	struct frame key;
+	struct hash_elem *e;
+	struct frame *frame;
+	bool success = false;
+
+	if (!page_is_cacheable (page))
+		return false;
+
+	key.inode = file_get_inode (page->file.file);
+	key.offset = page->file.offset;
+
+	lock_acquire (&frame_lock);
+	e = hash_find (&page_cache, &key.cache_elem);
+	frame = e != NULL ? hash_entry (e, struct frame, cache_elem) : NULL;
+	if (frame != NULL && !frame->pinned
+			&& frame->read_bytes == page->file.read_bytes) {
+		page->frame = frame;
+		list_push_back (&frame->mappers, &page->mapper_elem);
+		page_map (page, frame->kva);
+		page_cache_hit_cnt++;
+		success = true;
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Returns the frame table element that follows E, wrapping around
+ * at the end of the table. */
+static struct list_elem *
+clock_next (struct list_elem *e) {
+	if (e == NULL || e == list_end (&frame_table))
+		return list_begin (&frame_table);
+	e = list_next (e);
+	return e != list_end (&frame_table) ? e : list_begin (&frame_table);
+}
+
+/* Returns true if any page mapping FRAME was referenced since the last
+ * call, clearing the accessed bit of every mapper on the way. */
+static bool
+frame_test_and_clear_accessed (struct frame *frame) {
+	bool accessed = false;
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->mappers); e != list_end (&frame->mappers);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, mapper_elem);
+		uint64_t *pml4 = page->owner->pml4;
+
+		if (pml4_is_accessed (pml4, page->va)) {
+			pml4_set_accessed (pml4, page->va, false);
+			accessed = true;
+		}
+	}
+	return accessed;
+}
+
+/* Returns true if any page mapping FRAME has written to it. */
+static bool
+frame_is_dirty (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->mappers); e != list_end (&frame->mappers);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, mapper_elem);
+		if (pml4_is_dirty (page->owner->pml4, page->va))
+			return true;
+	}
+	return false;
+}
+
+/* Get the struct frame, that will be evicted.
+ *
+ * This is the second-chance clock with a preference for clean frames.
+ * Referenced frames lose their accessed bit and are skipped.  The
+ * first unreferenced clean frame is taken at once; an unreferenced
+ * dirty frame is remembered and taken only after a full revolution
+ * found nothing cleaner.  Since the first revolution clears every
+ * accessed bit, two revolutions always suffice unless every frame is
+ * pinned, in which case NULL is returned. */
 static struct frame *
 vm_get_victim (void) {
 	struct frame *victim = NULL;
-	 /* TODO: The policy for eviction is up to you. */
+	struct frame *dirty = NULL;
+	size_t scanned = 0;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	while (scanned < 2 * frame_cnt) {
+		if (scanned == frame_cnt && dirty != NULL)
+			break;
 
+		clock_hand = clock_next (clock_hand);
+		scanned++;
+
+		struct frame *frame = list_entry (clock_hand, struct frame, elem);
+		if (frame->pinned)
+			continue;
+		/* Pages scanned once in sequence get no second chance. */
+		if (frame_test_and_clear_accessed (frame)
+				&& frame->page->advice != MADV_SEQUENTIAL)
+			continue;
+		if (!frame_is_dirty (frame)) {
+			victim = frame;
+			break;
+		}
+		if (dirty == NULL)
+			dirty = frame;
+	}
+	if (victim == NULL)
+		victim = dirty;
+
+	evict_scan_cnt += scanned;
+	if ((long long) scanned > evict_scan_max)
+		evict_scan_max = scanned;
 	return victim;
 }
 
+/* Starts evicting VICTIM: pins it and unmaps every page that maps it,
+ * so that the mappers fault instead of modifying the frame while it is
+ * written out.  Clearing the present bit keeps the dirty bit around
+ * for swap_out to inspect.  The caller then drops FRAME_LOCK, calls
+ * swap_out() on the page of VICTIM, and hands the result to
+ * vm_evict_end(). */
+static void
+vm_evict_begin (struct frame *victim) {
+	struct list_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	victim->pinned = true;
+	victim->evicting = true;
+	for (e = list_begin (&victim->mappers); e != list_end (&victim->mappers);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, mapper_elem);
+		pml4_clear_page (page->owner->pml4, page->va);
+	}
+}
+
+/* Finishes evicting VICTIM, whose page was WRITTEN out or not.  If it
+ * was not, the mappings are put back and false is returned.  Otherwise
+ * every mapper lets go of VICTIM, which stays pinned for the caller to
+ * reuse or free, and true is returned. */
+static bool
+vm_evict_end (struct frame *victim, bool written) {
+	struct list_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	victim->evicting = false;
+	cond_broadcast (&evict_cond, &frame_lock);
+
+	if (!written) {
+		for (e = list_begin (&victim->mappers);
+				e != list_end (&victim->mappers); e = list_next (e))
+			page_map (list_entry (e, struct page, mapper_elem), victim->kva);
+		victim->pinned = false;
+		return false;
+	}
+
+	/* The other mappers of a shared anonymous frame refer to the swap
+	 * slot it went to; sharing a slot cannot fail. */
+	while (!list_empty (&victim->mappers)) {
+		struct page *page = list_entry (list_pop_front (&victim->mappers),
+				struct page, mapper_elem);
+		if (page != victim->page && page_get_type (page) == VM_ANON)
+			anon_swap_dup (page, victim->page);
+		page->frame = NULL;
+	}
+	vm_cache_remove (victim);
+	ksm_unlist (victim);
+	victim->page = NULL;
+	evict_cnt++;
+	return true;
+}
+
+/* Orders frames by owner and then by virtual address of their page,
+ * so that virtually adjacent anonymous pages get adjacent swap slots. */
+static bool
+victim_less (const struct frame *a, const struct frame *b) {
+	if (a->page->owner != b->page->owner)
+		return a->page->owner < b->page->owner;
+	return a->page->va < b->page->va;
+}
+
+/* Evicts a round of up to EVICT_BATCH victims and returns how many
+ * were evicted.  The anonymous ones are written to one run of
+ * consecutive swap slots in virtual address order, which keeps the
+ * swap writes sequential and lets a later swap-in read their
+ * neighbours ahead.  The victims are chosen and pinned under
+ * FRAME_LOCK, but written out without it.  If FRAMEP is not null, the
+ * first frame evicted is handed back through it, still pinned; the
+ * rest go back to the user pool. */
+static size_t
+vm_evict_batch (struct frame **framep) {
+	struct frame *victims[EVICT_BATCH];
+	bool written[EVICT_BATCH];
+	struct frame *frame = NULL;
+	size_t victim_cnt = 0, anon_cnt = 0, evicted = 0;
+	size_t i, j;
+
+	lock_acquire (&evict_lock);
+	lock_acquire (&frame_lock);
+	while (victim_cnt < EVICT_BATCH) {
+		struct frame *victim = vm_get_victim ();
+		if (victim == NULL)
+			break;
+		/* Pinning the victim makes the clock move past it. */
+		vm_evict_begin (victim);
+		if (page_get_type (victim->page) == VM_ANON)
+			anon_cnt++;
+
+		/* Insertion sort; the batch is tiny. */
+		for (j = victim_cnt; j > 0 && victim_less (victim, victims[j - 1]); j--)
+			victims[j] = victims[j - 1];
+		victims[j] = victim;
+		victim_cnt++;
+	}
+	lock_release (&frame_lock);
+
+	anon_swap_cluster_begin (anon_cnt);
+	for (i = 0; i < victim_cnt; i++)
+		written[i] = swap_out (victims[i]->page);
+	anon_swap_cluster_end ();
+
+	lock_acquire (&frame_lock);
+	for (i = 0; i < victim_cnt; i++) {
+		struct frame *victim = victims[i];
+
+		if (!vm_evict_end (victim, written[i]))
+			continue;
+		evicted++;
+		if (framep != NULL && frame == NULL)
+			frame = victim;
+		else
+			vm_free_frame (victim);
+	}
+	lock_release (&frame_lock);
+	lock_release (&evict_lock);
+
+	if (framep != NULL)
+		*framep = frame;
+	return evicted;
+}
+
 /* Evict one page and return the corresponding frame.
- * Return NULL on error.*/
+ * Return NULL on error. */
 static struct frame *
 vm_evict_frame (void) {
-	struct frame *victim UNUSED = vm_get_victim ();
-	/* TODO: swap out the victim and return the evicted frame. */
+	struct frame *frame;
+
+	vm_evict_batch (&frame);
+	return frame;
+}
+
+/* Returns the number of free pages in the user pool.  Every page taken
+ * from it is a frame in the frame table. */
+static size_t
+frame_free_cnt (void) {
+	return user_pool_cnt > frame_cnt ? user_pool_cnt - frame_cnt : 0;
+}
+
+/* Background reclaim.
+ *
+ * Once fewer than RECLAIM_LOW user pages are free, vm_get_frame()
+ * wakes up this thread, which evicts frames in batches, the same way
+ * direct reclaim does, until RECLAIM_HIGH pages are free.  Faults then
+ * find free frames instead of writing out victims themselves. */
+static void
+kswapd (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&kswapd_sema);
 
-	return NULL;
+		for (;;) {
+			size_t cnt = 0;
+			bool low;
+
+			lock_acquire (&frame_lock);
+			low = frame_free_cnt () < reclaim_high;
+			lock_release (&frame_lock);
+
+			if (low)
+				cnt = vm_evict_batch (NULL);
+
+			lock_acquire (&frame_lock);
+			kswapd_reclaim_cnt += cnt;
+			if (cnt == 0)
+				kswapd_awake = false;
+			lock_release (&frame_lock);
+
+			if (cnt == 0)
+				break;
+		}
+	}
 }
 
 /* palloc() and get frame. If there is no available page, evict the page
  * and return it. This always return valid address. That is, if the user pool
  * memory is full, this function evicts the frame to get the available memory
- * space.*/
+ * space.
+ * The returned frame is pinned; the caller unpins it once the contents
+ * are in place.  Returns NULL if nothing could be evicted, or if the
+ * pool is empty and EVICT is false. */
 static struct frame *
-vm_get_frame (void) {
+vm_get_frame (bool evict) {
 	struct frame *frame = NULL;
-	/* TODO: Fill this function. */
+	void *kva = palloc_get_page (PAL_USER);
+	uint64_t cycles = 0;
 
-	ASSERT (frame != NULL);
-	ASSERT (frame->page == NULL);
+	if (kva == NULL && evict) {
+		uint64_t start = rdtsc ();
+
+		frame = vm_evict_frame ();
+		cycles = rdtsc () - start;
+	}
+
+	lock_acquire (&frame_lock);
+	if (kva != NULL) {
+		frame = malloc (sizeof *frame);
+		if (frame != NULL) {
+			frame->kva = kva;
+			list_push_back (&frame_table, &frame->elem);
+			frame_cnt++;
+		} else
+			palloc_free_page (kva);
+	} else if (evict) {
+		direct_reclaim_cnt++;
+		direct_reclaim_cycles += cycles;
+	}
+
+	if (!kswapd_awake && frame_free_cnt () < reclaim_low) {
+		kswapd_awake = true;
+		kswapd_wake_cnt++;
+		sema_up (&kswapd_sema);
+	}
+
+	if (frame != NULL) {
+		frame->page = NULL;
+		list_init (&frame->mappers);
+		frame->pinned = true;
+		frame->evicting = false;
+		frame->inode = NULL;
+		frame->ksm_listed = false;
+	}
+	lock_release (&frame_lock);
 	return frame;
 }
 
-/* Growing the stack. */
+/* Removes FRAME from the frame table and frees it.  FRAME_LOCK must
+ * be held and FRAME must have no mappers left. */
 static void
-vm_stack_growth (void *addr UNUSED) {
+vm_free_frame (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+	ASSERT (list_empty (&frame->mappers));
+
+	vm_cache_remove (frame);
+	ksm_unlist (frame);
+	if (clock_hand == &frame->elem)
+		clock_hand = list_prev (clock_hand);
+	if (ksm_cursor == &frame->elem)
+		ksm_cursor = list_prev (ksm_cursor);
+	list_remove (&frame->elem);
+	frame_cnt--;
+	palloc_free_page (frame->kva);
+	free (frame);
 }
 
-/* Handle the fault on write_protected page */
+/* Detaches PAGE from its frame, if any, and removes its mapping.
+ * The frame is freed when PAGE was its last mapper.  If the frame is
+ * being evicted, waits for that to finish first. */
+void
+vm_unlink_frame (struct page *page) {
+	struct frame *frame;
+
+	lock_acquire (&frame_lock);
+	while (page->frame != NULL && page->frame->evicting)
+		cond_wait (&evict_cond, &frame_lock);
+	frame = page->frame;
+	if (frame != NULL) {
+		bool dirty = false;
+
+		/* The last mapper of a file-backed frame writes it back,
+		 * pinned so that the lock can be dropped meanwhile. */
+		if (page->owner->pml4 != NULL && !frame_is_shared (frame)
+				&& VM_TYPE (page->operations->type) == VM_FILE
+				&& !frame->pinned) {
+			frame->pinned = true;
+			lock_release (&frame_lock);
+			swap_out (page);
+			lock_acquire (&frame_lock);
+			frame->pinned = false;
+		}
+
+		if (page->owner->pml4 != NULL) {
+			dirty = pml4_is_dirty (page->owner->pml4, page->va);
+			pml4_clear_page (page->owner->pml4, page->va);
+		}
+		list_remove (&page->mapper_elem);
+		page->frame = NULL;
+		if (frame->page == page)
+			frame->page = list_empty (&frame->mappers) ? NULL
+				: list_entry (list_front (&frame->mappers),
+						struct page, mapper_elem);
+
+		/* Keep the writes of PAGE to a shared file-backed frame. */
+		if (dirty && frame->page != NULL
+				&& page_get_type (frame->page) == VM_FILE)
+			pml4_set_dirty (frame->page->owner->pml4, frame->page->va, true);
+		if (list_empty (&frame->mappers) && !frame->pinned)
+			vm_free_frame (frame);
+	}
+	lock_release (&frame_lock);
+}
+
+/* Pins the frame of PAGE for write-back, if PAGE is resident, not
+ * pinned already, and was written to through any of the mappers of the
+ * frame.  Their dirty bits are cleared, so that writes made after this
+ * point dirty the frame again.  Returns true if the frame was pinned;
+ * vm_unpin_page() releases it. */
+bool
+vm_pin_dirty_page (struct page *page) {
+	struct frame *frame;
+	bool dirty = false;
+
+	lock_acquire (&frame_lock);
+	frame = page->frame;
+	if (frame != NULL && !frame->pinned) {
+		struct list_elem *e;
+
+		for (e = list_begin (&frame->mappers); e != list_end (&frame->mappers);
+				e = list_next (e)) {
+			struct page *p = list_entry (e, struct page, mapper_elem);
+
+			if (pml4_is_dirty (p->owner->pml4, p->va)) {
+				pml4_set_dirty (p->owner->pml4, p->va, false);
+				dirty = true;
+			}
+		}
+		frame->pinned = dirty;
+	}
+	lock_release (&frame_lock);
+	return dirty;
+}
+
+/* Unpins the frame of PAGE. */
+void
+vm_unpin_page (struct page *page) {
+	lock_acquire (&frame_lock);
+	page->frame->pinned = false;
+	lock_release (&frame_lock);
+}
+
+/* Same-page merging.
+ *
+ * Forked processes often end up with many anonymous pages of the same
+ * contents.  Every KSM_SLEEP_MS milliseconds, ksmd looks at the next
+ * KSM_PAGES_TO_SCAN frames of the frame table and lists each
+ * anonymous one by a checksum of its contents.  When a frame matches
+ * one listed already, both are write-protected, compared byte by byte,
+ * and if equal the mappers of the new one move over to the listed one.
+ * The merged frame is then shared like a frame after fork, and a write
+ * to it is broken off by vm_handle_wp(). */
+
+/* Removes FRAME from the KSM table, if it is there. */
+static void
+ksm_unlist (struct frame *frame) {
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (frame->ksm_listed) {
+		hash_delete (&ksm_table, &frame->ksm_elem);
+		frame->ksm_listed = false;
+	}
+}
+
+/* Maps every mapper of FRAME read-only, so the contents of FRAME
+ * cannot change behind our back. */
+static void
+ksm_protect (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->mappers); e != list_end (&frame->mappers);
+			e = list_next (e)) {
+		struct page *page = list_entry (e, struct page, mapper_elem);
+		uint64_t *pml4 = page->owner->pml4;
+		bool dirty = pml4_is_dirty (pml4, page->va);
+
+		pml4_clear_page (pml4, page->va);
+		pml4_set_page (pml4, page->va, frame->kva, false);
+		pml4_set_dirty (pml4, page->va, dirty);
+	}
+}
+
+/* Maps every mapper of FRAME again with its usual permissions. */
+static void
+ksm_unprotect (struct frame *frame) {
+	struct list_elem *e;
+
+	for (e = list_begin (&frame->mappers); e != list_end (&frame->mappers);
+			e = list_next (e))
+		page_map (list_entry (e, struct page, mapper_elem), frame->kva);
+}
+
+/* Lists FRAME in the KSM table, or merges it into the listed frame
+ * with the same contents. */
+static void
+ksm_scan_frame (struct frame *frame) {
+	struct frame key, *twin;
+	struct hash_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&frame_lock));
+
+	if (frame->pinned || frame->page == NULL
+			|| page_get_type (frame->page) != VM_ANON)
+		return;
+	ksm_scan_cnt++;
+
+	key.ksm_sum = hash_bytes (frame->kva, PGSIZE);
+	if (frame->ksm_listed) {
+		if (frame->ksm_sum == key.ksm_sum)
+			return;
+		ksm_unlist (frame);
+	}
+
+	e = hash_find (&ksm_table, &key.ksm_elem);
+	twin = e != NULL ? hash_entry (e, struct frame, ksm_elem) : NULL;
+	if (twin != NULL && twin->pinned)
+		return;
+	if (twin != NULL) {
+		ksm_protect (frame);
+		ksm_protect (twin);
+		if (memcmp (frame->kva, twin->kva, PGSIZE) == 0) {
+			if (!frame_is_shared (twin))
+				ksm_share_cnt++;
+			while (!list_empty (&frame->mappers)) {
+				struct page *page = list_entry (list_pop_front (&frame->mappers),
+						struct page, mapper_elem);
+				page->frame = twin;
+				list_push_back (&twin->mappers, &page->mapper_elem);
+				page_map (page, twin->kva);
+			}
+			frame->page = NULL;
+			vm_free_frame (frame);
+			ksm_merge_cnt++;
+			return;
+		}
+
+		/* TWIN changed since it was listed. */
+		ksm_unprotect (frame);
+		ksm_unprotect (twin);
+		ksm_unlist (twin);
+	}
+
+	frame->ksm_sum = key.ksm_sum;
+	frame->ksm_listed = true;
+	hash_insert (&ksm_table, &frame->ksm_elem);
+}
+
+/* The same-page merging scanner. */
+static void
+ksmd (void *aux UNUSED) {
+	for (;;) {
+		size_t i;
+
+		timer_msleep (ksm_sleep_ms > 0 ? ksm_sleep_ms : 1);
+
+		lock_acquire (&frame_lock);
+		for (i = 0; i < ksm_pages_to_scan && frame_cnt > 0; i++) {
+			ksm_cursor = clock_next (ksm_cursor);
+			ksm_scan_frame (list_entry (ksm_cursor, struct frame, elem));
+		}
+		lock_release (&frame_lock);
+	}
+}
+
+/* Hash function and ordering for the KSM table. */
+static uint64_t
+ksm_hash (const struct hash_elem *e, void *aux UNUSED) {
+	return hash_entry (e, struct frame, ksm_elem)->ksm_sum;
+}
+
+static bool
+ksm_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct frame, ksm_elem)->ksm_sum
+		< hash_entry (b, struct frame, ksm_elem)->ksm_sum;
+}
+
+/* Growing the stack.
+ *
+ * ADDR faulted below the stack, which RSP says is in use.  Rather than
+ * one page per fault, the stack grows in one run: down to RSP or ADDR,
+ * whichever is lower, so a large object on the stack is covered at
+ * once, and then by half the current stack size again, up to
+ * STACK_AHEAD_MAX pages, so deep recursion faults less and less often.
+ * The faulting page is claimed like any other; the rest are loaded
+ * into free frames and mapped in batches.  Returns false if ADDR is
+ * not a stack access or lies beyond vm_stack_limit. */
+static bool
+vm_stack_growth (void *addr, void *rsp) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *floor = (void *) (USER_STACK - ROUND_UP (vm_stack_limit, PGSIZE));
+	void *fault = pg_round_down (addr);
+	struct page *batch[FAULT_AROUND_MAX];
+	size_t batch_cnt = 0, ahead;
+	void *bottom, *start, *va;
+
+	/* PUSH faults 8 bytes below RSP; anything lower is not the stack. */
+	if (addr >= (void *) USER_STACK || addr < floor
+			|| (uint8_t *) addr < (uint8_t *) rsp - 8)
+		return false;
+
+	for (bottom = fault + PGSIZE; bottom < (void *) USER_STACK
+			&& spt_find_page (spt, bottom) == NULL; bottom += PGSIZE)
+		continue;
+	ahead = (USER_STACK - (uintptr_t) bottom) / PGSIZE / 2;
+	if (ahead > STACK_AHEAD_MAX)
+		ahead = STACK_AHEAD_MAX;
+	start = (rsp < addr && rsp >= floor) ? pg_round_down (rsp) : fault;
+	start = (size_t) (start - floor) / PGSIZE > ahead
+		? start - ahead * PGSIZE : floor;
+
+	for (va = start; va < bottom; va += PGSIZE)
+		if (spt_find_page (spt, va) == NULL
+				&& !vm_alloc_page (VM_ANON | VM_STACK, va, true)
+				&& va == fault)
+			return false;
+	if (!vm_claim_page (fault))
+		return false;
+	stack_growth_cnt++;
+
+	for (va = start; va < bottom; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+
+		if (page != NULL && page->frame == NULL)
+			batch[batch_cnt++] = page;
+		if (batch_cnt == FAULT_AROUND_MAX
+				|| (va + PGSIZE >= bottom && batch_cnt > 0)) {
+			size_t loaded = vm_load_pages (batch, batch_cnt, NULL);
+
+			stack_ahead_cnt += loaded;
+			if (loaded < batch_cnt)
+				break;
+			batch_cnt = 0;
+		}
+	}
+	return true;
+}
+
+/* Maps the zero page read-only at PAGE, if PAGE is an anonymous page
+ * that was never brought in and has no initializer that could fill
+ * it with anything but zeros.  Returns true if PAGE was mapped. */
+static bool
+vm_map_zero (struct page *page) {
+	bool success;
+
+	if (VM_TYPE (page->operations->type) != VM_UNINIT
+			|| VM_TYPE (page->uninit.type) != VM_ANON
+			|| page->uninit.init != NULL || page->uninit.aux != NULL)
+		return false;
+
+	lock_acquire (&frame_lock);
+	success = pml4_set_page (page->owner->pml4, page->va, zero_frame.kva,
+			false);
+	if (success) {
+		page->frame = &zero_frame;
+		list_push_back (&zero_frame.mappers, &page->mapper_elem);
+		zero_map_cnt++;
+	}
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Handle the fault on write_protected page
+ *
+ * A writable page is mapped read-only while it shares its frame with
+ * pages of forked processes.  If the others have gone, the frame is
+ * taken over in place; otherwise the page gets a private copy.  A
+ * frame that is pinned, being written out, is left alone: the access
+ * is retried once it is done. */
 static bool
-vm_handle_wp (struct page *page UNUSED) {
+vm_handle_wp (struct page *page) {
+	struct frame *frame, *old;
+
+	if (page->frame == &zero_frame) {
+		vm_unlink_frame (page);
+		zero_upgrade_cnt++;
+		return vm_do_claim_page (page, true);
+	}
+
+	lock_acquire (&frame_lock);
+	old = page->frame;
+	if (old == NULL || old->pinned) {
+		lock_release (&frame_lock);
+		return true;
+	}
+	if (!frame_is_shared (old)) {
+		page_map (page, old->kva);
+		cow_reuse_cnt++;
+		lock_release (&frame_lock);
+		return true;
+	}
+	lock_release (&frame_lock);
+
+	frame = vm_get_frame (true);
+	if (frame == NULL)
+		return false;
+
+	/* The frame lock was dropped while we got FRAME, so the sharers
+	 * of OLD may have exited, or OLD may have been evicted. */
+	lock_acquire (&frame_lock);
+	old = page->frame;
+	if (old == NULL || old->pinned) {
+		/* Retrying the access faults the page in again. */
+		vm_free_frame (frame);
+	} else if (!frame_is_shared (old)) {
+		/* PAGE is the last mapper; take OLD over in place. */
+		vm_free_frame (frame);
+		page_map (page, old->kva);
+		cow_reuse_cnt++;
+	} else {
+		memcpy (frame->kva, old->kva, PGSIZE);
+		list_remove (&page->mapper_elem);
+		if (old->page == page)
+			old->page = list_entry (list_front (&old->mappers),
+					struct page, mapper_elem);
+		/* A mapper left on its own may write again. */
+		if (!frame_is_shared (old))
+			page_map (old->page, old->kva);
+
+		frame->page = page;
+		page->frame = frame;
+		list_push_back (&frame->mappers, &page->mapper_elem);
+		page_map (page, frame->kva);
+		pml4_set_dirty (page->owner->pml4, page->va, true);
+		frame->pinned = false;
+		cow_copy_cnt++;
+	}
+	lock_release (&frame_lock);
+	return true;
+}
+
+/* Returns true if NEXT is not resident and gets its contents from the
+ * same place as PAGE, the page that just faulted in.  INIT is the lazy
+ * loader PAGE had before it faulted, if any. */
+static bool
+fault_around_match (struct page *page, vm_initializer *init,
+		struct page *next) {
+	if (next->frame != NULL)
+		return false;
+	if (init != NULL)
+		return VM_TYPE (next->operations->type) == VM_UNINIT
+			&& next->uninit.init == init;
+	return VM_TYPE (next->operations->type) == VM_FILE
+		&& next->file.file == page->file.file;
+}
+
+/* Loads the CNT pages in PAGES, which are not resident, into free
+ * frames and maps them, stopping once no free frame is left.  All of
+ * the pages are loaded first and then mapped in one pass, so none of
+ * them is visible half-filled.  MARKER, if among them, is loaded but
+ * left unmapped, so that touching it takes a cheap fault.  Returns the
+ * number of pages brought in. */
+static size_t
+vm_load_pages (struct page **pages, size_t cnt, struct page *marker) {
+	size_t loaded = 0, mapped = 0;
+	size_t i;
+
+	for (i = 0; i < cnt; i++) {
+		struct page *page = pages[i];
+		struct frame *frame;
+
+		if (vm_cache_share (page)) {
+			mapped++;
+			continue;
+		}
+		frame = vm_get_frame (false);
+		if (frame == NULL)
+			break;
+
+		lock_acquire (&frame_lock);
+		frame->page = page;
+		page->frame = frame;
+		list_push_back (&frame->mappers, &page->mapper_elem);
+		lock_release (&frame_lock);
+
+		if (swap_in (page, frame->kva)) {
+			vm_cache_insert (page);
+			pages[loaded++] = page;
+		} else
+			vm_unclaim_page (page);
+	}
+
+	for (i = 0; i < loaded; i++) {
+		struct page *page = pages[i];
+
+		if (page != marker && !pml4_set_page (page->owner->pml4, page->va,
+					page->frame->kva, page->writable)) {
+			vm_unclaim_page (page);
+			continue;
+		}
+		lock_acquire (&frame_lock);
+		page->frame->pinned = false;
+		lock_release (&frame_lock);
+		mapped++;
+	}
+	return mapped;
+}
+
+/* Brings in the pages around PAGE, in the aligned window of
+ * vm_fault_around_pages pages that contains it, whose contents come
+ * from the same file, as long as free frames are at hand. */
+static void
+vm_fault_around (struct page *page, vm_initializer *init) {
+	struct supplemental_page_table *spt = &page->owner->spt;
+	struct page *batch[FAULT_AROUND_MAX];
+	size_t window = vm_fault_around_pages;
+	size_t batch_cnt = 0;
+	void *start;
+	size_t i;
+
+	if (window > FAULT_AROUND_MAX)
+		window = FAULT_AROUND_MAX;
+	if (window <= 1)
+		return;
+	start = (void *) ((pg_no (page->va) / window) * window * PGSIZE);
+
+	for (i = 0; i < window; i++) {
+		struct page *next = spt_find_page (spt, start + i * PGSIZE);
+
+		if (next != NULL && next != page
+				&& fault_around_match (page, init, next))
+			batch[batch_cnt++] = next;
+	}
+	fault_around_cnt += vm_load_pages (batch, batch_cnt, NULL);
+}
+
+/* Adaptive readahead for mmapped files.
+ *
+ * Each region remembers the page a sequential scan would fault on
+ * next.  A fault there starts a window of MMAP_RA_INIT pages after it;
+ * any other fault, including the first one in the region, collapses
+ * the window, leaving one page per fault.
+ * A window is read with a marker page halfway in, which is loaded but
+ * not mapped.  When the scan reaches the marker, the next window,
+ * twice as large up to MMAP_RA_MAX, is read while the scan still has
+ * the second half of the current one to go through. */
+#define MMAP_RA_INIT 4
+#define MMAP_RA_MAX FAULT_AROUND_MAX
+
+/* Updates the access pattern of the region of PAGE, which was just
+ * faulted in, or whose marker was just hit if MARKER_HIT, and reads
+ * the next window ahead if the scan is sequential. */
+static void
+vm_mmap_readahead (struct page *page, bool marker_hit) {
+	struct mmap_file *map = page->file.map;
+	struct supplemental_page_table *spt = &page->owner->spt;
+	struct page *batch[MMAP_RA_MAX];
+	struct page *marker;
+	void *end = map->addr + map->page_cnt * PGSIZE;
+	void *start;
+	size_t cnt, batch_cnt = 0;
+	size_t i;
+
+	if (marker_hit) {
+		start = map->ra_next;
+		cnt = map->ra_size * 2;
+		ra_marker_cnt++;
+	} else if (page->advice == MADV_SEQUENTIAL) {
+		start = page->va + PGSIZE;
+		cnt = MMAP_RA_MAX;
+	} else if (page->va == map->ra_next && page->advice != MADV_RANDOM) {
+		start = page->va + PGSIZE;
+		cnt = map->ra_size > 0 ? map->ra_size * 2 : MMAP_RA_INIT;
+	} else {
+		if (map->ra_size > 0)
+			ra_collapse_cnt++;
+		map->ra_size = 0;
+		map->ra_next = page->va + PGSIZE;
+		map->ra_marker = NULL;
+		return;
+	}
+
+	if (cnt > MMAP_RA_MAX)
+		cnt = MMAP_RA_MAX;
+	if (start >= end)
+		cnt = 0;
+	else if (cnt > (size_t) (end - start) / PGSIZE)
+		cnt = (end - start) / PGSIZE;
+	map->ra_size = cnt;
+	map->ra_next = start + cnt * PGSIZE;
+	map->ra_marker = cnt > 0 ? start + cnt / 2 * PGSIZE : NULL;
+
+	marker = NULL;
+	for (i = 0; i < cnt; i++) {
+		struct page *next = spt_find_page (spt, start + i * PGSIZE);
+
+		if (next == NULL || next->frame != NULL
+				|| VM_TYPE (next->operations->type) != VM_FILE
+				|| next->file.map != map)
+			continue;
+		if (next->va == map->ra_marker)
+			marker = next;
+		batch[batch_cnt++] = next;
+	}
+	if (marker == NULL)
+		map->ra_marker = NULL;
+	ra_page_cnt += vm_load_pages (batch, batch_cnt, marker);
+}
+
+/* Maps PAGE if it is resident but not mapped, which is the case for a
+ * readahead marker, and starts the next readahead window.  Returns
+ * false if PAGE has to be brought in. */
+static bool
+vm_map_resident (struct page *page) {
+	struct frame *frame;
+	bool marker_hit;
+
+	lock_acquire (&frame_lock);
+	frame = page->frame;
+	if (frame == NULL) {
+		lock_release (&frame_lock);
+		return false;
+	}
+	/* A pinned frame is on its way in or out; retry the access. */
+	if (!frame->pinned)
+		page_map (page, frame->kva);
+	lock_release (&frame_lock);
+
+	marker_hit = page_get_type (page) == VM_FILE && page->file.map != NULL
+		&& page->file.map->ra_marker == page->va;
+	if (marker_hit) {
+		page->file.map->ra_marker = NULL;
+		vm_mmap_readahead (page, true);
+	}
+	return true;
 }
 
 /* Return true on success */
 bool
-vm_try_handle_fault (struct intr_frame *f UNUSED, void *addr UNUSED,
-		bool user UNUSED, bool write UNUSED, bool not_present UNUSED) {
-	struct supplemental_page_table *spt UNUSED = &thread_current ()->spt;
+vm_try_handle_fault (struct intr_frame *f, void *addr,
+		bool user, bool write, bool not_present) {
+	struct thread *t = thread_current ();
+	struct supplemental_page_table *spt = &t->spt;
 	struct page *page = NULL;
-	/* TODO: Validate the fault */
-	/* TODO: Your code goes here */
+	vm_initializer *init = NULL;
+
+	if (addr == NULL || is_kernel_vaddr (addr))
+		return false;
+
+	page = spt_find_page (spt, addr);
+	if (page == NULL) {
+		t->fault_cause = FAULT_STACK;
+		return vm_stack_growth (addr, user ? (void *) f->rsp : t->user_rsp);
+	}
+	if (write && !page->writable)
+		return false;
+	if (!not_present) {
+		t->fault_cause = page->frame == &zero_frame ? FAULT_ZERO : FAULT_COW;
+		return vm_handle_wp (page);
+	}
+
+	/* Mapping an already resident frame is the tail of a lazy load
+	 * that readahead has done in advance. */
+	t->fault_cause = FAULT_LAZY;
+	if (vm_map_resident (page))
+		return true;
+	t->fault_cause = FAULT_ZERO;
+	if (!write && vm_map_zero (page))
+		return true;
 
-	return vm_do_claim_page (page);
+	if (VM_TYPE (page->operations->type) == VM_UNINIT) {
+		init = page->uninit.init;
+		t->fault_cause = init != NULL || page->uninit.aux != NULL
+			? FAULT_LAZY : FAULT_ZERO;
+	} else
+		t->fault_cause = page_get_type (page) == VM_FILE
+			? FAULT_LAZY : FAULT_SWAP;
+	if (!vm_do_claim_page (page, true))
+		return false;
+	if (page_get_type (page) == VM_FILE && page->file.map != NULL
+			&& page->file.map->readahead)
+		vm_mmap_readahead (page, false);
+	else if ((init != NULL || page_get_type (page) == VM_FILE)
+			&& page->advice != MADV_RANDOM)
+		vm_fault_around (page, init);
+	return true;
 }
 
 /* Free the page.
@@ -150,41 +1342,372 @@ vm_dealloc_page (struct page *page) {
 
 /* Claim the page that allocate on VA. */
 bool
-vm_claim_page (void *va UNUSED) {
-	struct page *page = NULL;
-	/* TODO: Fill this function */
+vm_claim_page (void *va) {
+	struct page *page = spt_find_page (&thread_current ()->spt, va);
 
-	return vm_do_claim_page (page);
+	if (page == NULL)
+		return false;
+	return vm_do_claim_page (page, true);
+}
+
+/* Claims PAGE only if a free frame is available, without evicting
+ * anything.  Used to bring in pages speculatively. */
+bool
+vm_try_claim_page (struct page *page) {
+	return vm_do_claim_page (page, false);
 }
 
 /* Claim the PAGE and set up the mmu. */
 static bool
-vm_do_claim_page (struct page *page) {
-	struct frame *frame = vm_get_frame ();
+vm_do_claim_page (struct page *page, bool evict) {
+	struct frame *frame;
+	bool success;
+
+	if (vm_cache_share (page))
+		return true;
+	frame = vm_get_frame (evict);
+	if (frame == NULL)
+		return false;
 
 	/* Set links */
+	lock_acquire (&frame_lock);
 	frame->page = page;
 	page->frame = frame;
+	list_push_back (&frame->mappers, &page->mapper_elem);
+	lock_release (&frame_lock);
+
+	/* The frame stays pinned until its contents are in place. */
+	success = pml4_set_page (page->owner->pml4, page->va, frame->kva,
+			page->writable)
+		&& swap_in (page, frame->kva);
+
+	if (!success) {
+		vm_unclaim_page (page);
+		return false;
+	}
+	vm_cache_insert (page);
+
+	lock_acquire (&frame_lock);
+	frame->pinned = false;
+	lock_release (&frame_lock);
+	return true;
+}
 
-	/* TODO: Insert page table entry to map page's VA to frame's PA. */
+/* Gives back the pinned frame PAGE was being loaded into, after the
+ * load failed.  The frame is still pinned, so no one else has seen
+ * it. */
+static void
+vm_unclaim_page (struct page *page) {
+	struct frame *frame = page->frame;
+
+	lock_acquire (&frame_lock);
+	ASSERT (frame->pinned);
+	pml4_clear_page (page->owner->pml4, page->va);
+	list_remove (&page->mapper_elem);
+	page->frame = NULL;
+	frame->page = NULL;
+	vm_free_frame (frame);
+	lock_release (&frame_lock);
+}
+
+/* Brings in the pages of [START, END) that are not resident, as long
+ * as free frames are at hand. */
+static void
+vm_prefetch (void *start, void *end) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	struct page *batch[FAULT_AROUND_MAX];
+	size_t batch_cnt = 0;
+	void *va;
+
+	for (va = start; va < end; va += PGSIZE) {
+		struct page *page = spt_find_page (spt, va);
+
+		if (page->frame == NULL)
+			batch[batch_cnt++] = page;
+		if (batch_cnt == FAULT_AROUND_MAX || (va + PGSIZE >= end && batch_cnt)) {
+			size_t loaded = vm_load_pages (batch, batch_cnt, NULL);
+
+			madvise_prefetch_cnt += loaded;
+			if (loaded < batch_cnt)
+				break;
+			batch_cnt = 0;
+		}
+	}
+}
+
+/* Drops the contents of PAGE.  A file-backed page is written back if
+ * it was modified, and is read from the file again on the next access.
+ * An anonymous page gives up its frame and swap space and starts over
+ * the way it was created: from its lazy loader, such as an executable's
+ * data segment, or as a page of zeros.  Returns false if the page could
+ * not be recreated, in which case it is gone. */
+static bool
+vm_drop_page (struct page *page) {
+	enum vm_type type = VM_TYPE (page->operations->type);
+
+	if (type == VM_FILE) {
+		struct frame *frame;
+		bool shared = false;
+
+		lock_acquire (&frame_lock);
+		frame = page->frame;
+		if (frame != NULL && !frame->pinned) {
+			shared = frame_is_shared (frame);
+			if (!shared) {
+				bool written;
 
-	return swap_in (page, frame->kva);
+				vm_evict_begin (frame);
+				lock_release (&frame_lock);
+				written = swap_out (page);
+				lock_acquire (&frame_lock);
+				if (vm_evict_end (frame, written))
+					vm_free_frame (frame);
+			}
+		}
+		lock_release (&frame_lock);
+
+		/* Others keep using a shared frame. */
+		if (shared)
+			vm_unlink_frame (page);
+	} else if (type == VM_ANON) {
+		struct supplemental_page_table *spt = &page->owner->spt;
+		void *va = page->va;
+		bool writable = page->writable;
+		unsigned char advice = page->advice;
+		enum vm_type anon_type = page->anon.type;
+		vm_initializer *init = page->anon.init;
+		void *aux = page->anon.aux;
+		size_t aux_size = page->anon.aux_size;
+
+		/* The new page takes over AUX. */
+		page->anon.aux = NULL;
+		spt_remove_page (spt, page);
+		if (!vm_alloc_page_with_initializer (anon_type, va, writable, init,
+					aux)) {
+			free (aux);
+			return false;
+		}
+		page = spt_find_page (spt, va);
+		page->advice = advice;
+		page->uninit.aux_size = aux_size;
+	}
+	madvise_drop_cnt++;
+	return true;
+}
+
+/* Applies ADVICE, one of the MADV_* values, to the pages of the current
+ * process in [ADDR, ADDR + LENGTH).  Returns 0 on success, or -1 if
+ * ADDR is not page-aligned, ADVICE is unknown, some page in the range
+ * is not mapped, or MADV_DONTNEED could not recreate a page. */
+int
+vm_madvise (void *addr, size_t length, int advice) {
+	struct supplemental_page_table *spt = &thread_current ()->spt;
+	void *end = pg_round_up (addr + length);
+	void *va;
+
+	if (pg_ofs (addr) != 0 || end < addr || !is_user_vaddr (addr)
+			|| (end > addr && !is_user_vaddr (end - 1)))
+		return -1;
+	for (va = addr; va < end; va += PGSIZE)
+		if (spt_find_page (spt, va) == NULL)
+			return -1;
+
+	switch (advice) {
+		case MADV_NORMAL:
+		case MADV_RANDOM:
+		case MADV_SEQUENTIAL:
+			for (va = addr; va < end; va += PGSIZE)
+				spt_find_page (spt, va)->advice = advice;
+			break;
+		case MADV_WILLNEED:
+			vm_prefetch (addr, end);
+			break;
+		case MADV_DONTNEED:
+			for (va = addr; va < end; va += PGSIZE)
+				if (!vm_drop_page (spt_find_page (spt, va)))
+					return -1;
+			break;
+		default:
+			return -1;
+	}
+	return 0;
+}
+
+/* Hash function and ordering for the pages of an spt. */
+static uint64_t
+page_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct page *page = hash_entry (e, struct page, spt_elem);
+	return hash_bytes (&page->va, sizeof page->va);
+}
+
+static bool
+page_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	return hash_entry (a, struct page, spt_elem)->va
+		< hash_entry (b, struct page, spt_elem)->va;
+}
+
+/* Hash function and ordering for the frames of the page cache. */
+static uint64_t
+cache_hash (const struct hash_elem *e, void *aux UNUSED) {
+	const struct frame *frame = hash_entry (e, struct frame, cache_elem);
+	return hash_bytes (&frame->inode, sizeof frame->inode)
+		^ hash_int (frame->offset);
+}
+
+static bool
+cache_less (const struct hash_elem *a, const struct hash_elem *b,
+		void *aux UNUSED) {
+	const struct frame *fa = hash_entry (a, struct frame, cache_elem);
+	const struct frame *fb = hash_entry (b, struct frame, cache_elem);
+
+	if (fa->inode != fb->inode)
+		return fa->inode < fb->inode;
+	return fa->offset < fb->offset;
 }
 
 /* Initialize new supplemental page table */
 void
-supplemental_page_table_init (struct supplemental_page_table *spt UNUSED) {
+supplemental_page_table_init (struct supplemental_page_table *spt) {
+	hash_init (&spt->pages, page_hash, page_less, NULL);
+}
+
+/* Gives DST, the current thread's copy of SRC, the contents of SRC.
+ * A resident SRC shares its frame with DST, write-protecting both;
+ * otherwise DST refers to the same backing store.  A frame on its way
+ * out is waited for, and the frame lock keeps SRC from being evicted
+ * halfway. */
+static bool
+page_share (struct page *dst, struct page *src) {
+	struct frame *frame;
+	bool success = true;
+
+	lock_acquire (&frame_lock);
+	while (src->frame != NULL && src->frame->evicting)
+		cond_wait (&evict_cond, &frame_lock);
+	frame = src->frame;
+	if (frame != NULL) {
+		dst->frame = frame;
+		list_push_back (&frame->mappers, &dst->mapper_elem);
+		page_map (src, frame->kva);
+		page_map (dst, frame->kva);
+		cow_share_cnt++;
+	} else if (page_get_type (src) == VM_ANON)
+		success = anon_swap_dup (dst, src);
+	lock_release (&frame_lock);
+	return success;
+}
+
+/* Duplicates SRC, a page of the parent, into the current thread's spt.
+ *
+ * Resident pages share their frame copy-on-write.  Swapped-out
+ * anonymous pages share the swap slot, and file-backed ones just read
+ * the file again.  Pages not brought in yet stay that way, with a copy
+ * of the lazy loader's aux; only an aux of unknown size forces SRC to
+ * be brought in first, to be shared like the rest. */
+static bool
+spt_copy_page (struct supplemental_page_table *dst, struct page *src) {
+	struct page *page;
+
+	if (VM_TYPE (src->operations->type) == VM_UNINIT) {
+		struct uninit_page *uninit = &src->uninit;
+
+		if (uninit->aux == NULL || uninit->aux_size > 0) {
+			void *aux = NULL;
+
+			if (uninit->aux != NULL) {
+				aux = malloc (uninit->aux_size);
+				if (aux == NULL)
+					return false;
+				memcpy (aux, uninit->aux, uninit->aux_size);
+			}
+			if (!vm_alloc_page_with_initializer (uninit->type, src->va,
+						src->writable, uninit->init, aux)) {
+				free (aux);
+				return false;
+			}
+			page = spt_find_page (dst, src->va);
+			page->uninit.aux_size = uninit->aux_size;
+			page->advice = src->advice;
+			return true;
+		}
+		if (!vm_do_claim_page (src, true))
+			return false;
+	}
+
+	page = malloc (sizeof *page);
+	if (page == NULL)
+		return false;
+	memcpy (page, src, sizeof *page);
+	page->owner = thread_current ();
+	page->frame = NULL;
+	if (page_get_type (page) == VM_FILE)
+		file_backed_dup (page);
+	else if (page_get_type (page) == VM_ANON) {
+		page->anon.slot = SWAP_SLOT_NONE;
+		page->anon.zswap = NULL;
+		page->anon.readahead = false;
+		if (src->anon.aux != NULL) {
+			page->anon.aux = malloc (src->anon.aux_size);
+			if (page->anon.aux == NULL) {
+				free (page);
+				return false;
+			}
+			memcpy (page->anon.aux, src->anon.aux, src->anon.aux_size);
+		}
+	}
+	if (!spt_insert_page (dst, page)) {
+		vm_dealloc_page (page);
+		return false;
+	}
+	return page_share (page, src);
 }
 
 /* Copy supplemental page table from src to dst */
 bool
-supplemental_page_table_copy (struct supplemental_page_table *dst UNUSED,
-		struct supplemental_page_table *src UNUSED) {
+supplemental_page_table_copy (struct supplemental_page_table *dst,
+		struct supplemental_page_table *src) {
+	struct hash_iterator i;
+
+	hash_first (&i, &src->pages);
+	while (hash_next (&i))
+		if (!spt_copy_page (dst, hash_entry (hash_cur (&i), struct page,
+						spt_elem)))
+			return false;
+	return true;
+}
+
+/* Destroys the page that contains E, for hash_clear(). */
+static void
+spt_destroy_page (struct hash_elem *e, void *aux UNUSED) {
+	vm_dealloc_page (hash_entry (e, struct page, spt_elem));
 }
 
 /* Free the resource hold by the supplemental page table */
 void
-supplemental_page_table_kill (struct supplemental_page_table *spt UNUSED) {
-	/* TODO: Destroy all the supplemental_page_table hold by thread and
-	 * TODO: writeback all the modified contents to the storage. */
+supplemental_page_table_kill (struct supplemental_page_table *spt) {
+	struct page **pages;
+	struct hash_iterator i;
+	size_t cnt = 0;
+
+	/* Write back the modified file-backed pages all at once, so the
+	 * writes can be sorted and merged, instead of page by page as
+	 * they are destroyed.  Each destroy still writes back whatever is
+	 * left. */
+	pages = malloc (hash_size (&spt->pages) * sizeof *pages);
+	if (pages != NULL) {
+		hash_first (&i, &spt->pages);
+		while (hash_next (&i)) {
+			struct page *page = hash_entry (hash_cur (&i), struct page, spt_elem);
+			if (VM_TYPE (page->operations->type) == VM_FILE
+					&& page->frame != NULL)
+				pages[cnt++] = page;
+		}
+		file_writeback (pages, cnt);
+		free (pages);
+	}
+
+	/* The table itself stays usable, since process_exec() reloads into
+	 * it. */
+	hash_clear (&spt->pages, spt_destroy_page);
 }